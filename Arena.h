@@ -0,0 +1,114 @@
+// *** NODE ARENA ***
+//
+// Expr and Stmt nodes, and the Symbols and Types the checker makes for
+// them, are carved out of large blocks instead of one malloc per node, so
+// nodes built by consecutive reductions end up adjacent in memory.  The
+// command line keeps them until it exits.  checkSource (FrontEnd.h)
+// instead takes a Mark before each call and releases the previous call's:
+// while a mark is live every node built registers its destructor, and
+// release runs those newest first, frees the blocks obtained since the
+// mark and hands the rest of the mark's block back.
+
+struct Arena
+{
+    enum { BLOCK_SIZE = 1 << 16, ALIGN = 16 };
+
+    typedef void (*Destroy)(void *);
+
+    struct Mark
+    {
+        size_t blocks, owned, used;
+        char * next;
+        char * limit;
+    };
+
+    char * next;
+    char * limit;
+    size_t used;   // bytes handed out
+    size_t blocks; // blocks obtained from malloc
+    vector<char *> chunks; // those blocks, oldest first
+    vector<pair<void *, Destroy> > owned; // nodes built under a live mark
+    int marks;
+
+    Arena()
+        : next(0), limit(0), used(0), blocks(0), marks(0)
+    {
+    }
+
+    void * allocate(size_t n)
+    {
+        n = (n + ALIGN - 1) & ~(size_t) (ALIGN - 1);
+        if (n > (size_t) (limit - next))
+            grow(n);
+        void * p = next;
+        next += n;
+        used += n;
+        return p;
+    }
+
+    void grow(size_t n)
+    {
+        size_t size = n > (size_t) BLOCK_SIZE ? n : (size_t) BLOCK_SIZE;
+        next = static_cast<char *>(malloc(size));
+        if (!next)
+        {
+            compiler_error("out of memory for AST nodes");
+            exit(1);
+        }
+        limit = next + size;
+        chunks.push_back(next);
+        ++blocks;
+    }
+
+    // Called by each node's constructor; a no-op unless a mark is live.
+    void own(void * node, Destroy destroy)
+    {
+        if (marks)
+            owned.push_back(make_pair(node, destroy));
+    }
+
+    // For an object that must outlive every mark, made with ::new just
+    // before: it was the last to register.
+    void disown(void * node)
+    {
+        if (!owned.empty() && owned.back().first == node)
+            owned.pop_back();
+    }
+
+    Mark mark()
+    {
+        ++marks;
+        Mark m = {blocks, owned.size(), used, next, limit};
+        return m;
+    }
+
+    // Marks are released in the reverse order they were taken.
+    void release(const Mark & m)
+    {
+        while (owned.size() > m.owned)
+        {
+            owned.back().second(owned.back().first);
+            owned.pop_back();
+        }
+        for (; blocks > m.blocks; --blocks)
+        {
+            free(chunks.back());
+            chunks.pop_back();
+        }
+        used = m.used;
+        next = m.next;
+        limit = m.limit;
+        --marks;
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** Node Arena: " << used << " bytes in " << blocks << " blocks ***" << endl;
+    }
+};
+
+inline Arena & nodeArena()
+{
+    static Arena arena;
+    return arena;
+}
@@ -0,0 +1,127 @@
+#include "all.h"
+
+// *** BOUNDS CHECK ELIMINATION ***
+//
+// A list access l[i] needs no check when 0 <= i and i < len(l) are both
+// known.  The language has no way to change a list's length once it is
+// built, so len(l) is a fixed value for each SSA value l, and
+//
+//     i >= 0     when i is a non-negative constant, a len, a sum or product
+//                of such values, or a phi of them, such as the index of a
+//                for loop or of while i < len(l): ... i = i + 1
+//     i < len(l) when the access is dominated by the true edge of i < n or
+//                n > i (or the false edge of i >= n), where n is len(l) or
+//                a constant no larger than the length of list literal l
+//
+// or when l is a list literal and i a constant in range.  Proven accesses
+// are marked inRange; an engine skips the check and the passes may drop or
+// move them like any non-trapping op.
+
+BoundsStats boundsStats;
+
+static bool nonNegative(IRInstr * v, set<IRInstr *> & assumed)
+{
+    switch (v->op)
+    {
+        case irConst:
+            return v->imm >= 0;
+        case irLen:
+            return true;
+        case irAdd: case irMul:
+            return nonNegative(v->args[0], assumed) && nonNegative(v->args[1], assumed);
+        case irAddImm:
+            return v->imm >= 0 && nonNegative(v->args[0], assumed);
+        case irPhi:
+            if (!assumed.insert(v).second)
+                return true; // around the loop: holds if every other input holds
+            for (size_t i = 0; i < v->args.size(); ++i)
+                if (!nonNegative(v->args[i], assumed))
+                    return false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The length of list l if it is known at compile time, else -1.
+static long long knownLength(IRInstr * l)
+{
+    return l->op == irList ? (long long) l->args.size() : -1;
+}
+
+// Whether n is at most len(l).
+static bool boundedByLength(IRInstr * n, IRInstr * l)
+{
+    if (n->op == irLen && n->args[0] == l)
+        return true;
+    return n->op == irConst && n->imm <= knownLength(l);
+}
+
+// Whether reaching b through its only pred implies i < len(l).
+static bool edgeProvesBelow(IRBlock * b, IRInstr * i, IRInstr * l)
+{
+    if (b->preds.size() != 1)
+        return false;
+    IRInstr * t = b->preds[0]->terminator();
+    if (!t || t->targets.size() != 2 || t->targets[0] == t->targets[1])
+        return false;
+    IROp op;
+    IRInstr * x;
+    IRInstr * y;
+    if (t->op == irCmpBr)
+    {
+        op = IROp(t->imm);
+        x = t->args[0];
+        y = t->args[1];
+    }
+    else if (t->op == irCbr && t->args[0]->args.size() == 2)
+    {
+        op = t->args[0]->op;
+        x = t->args[0]->args[0];
+        y = t->args[0]->args[1];
+    }
+    else
+        return false;
+    bool taken = t->targets[0] == b;
+    if (taken && op == irLT)
+        return x == i && boundedByLength(y, l);
+    if (taken && op == irGT)
+        return y == i && boundedByLength(x, l);
+    if (!taken && op == irGE)
+        return x == i && boundedByLength(y, l);
+    if (!taken && op == irLE)
+        return y == i && boundedByLength(x, l);
+    return false;
+}
+
+static bool belowLength(IRInstr * in, IRInstr * i, IRInstr * l)
+{
+    if (i->op == irConst && i->imm < knownLength(l))
+        return true;
+    for (IRBlock * b = in->block; ; b = b->idom)
+    {
+        if (edgeProvesBelow(b, i, l))
+            return true;
+        if (!b->idom || b->idom == b)
+            return false;
+    }
+}
+
+void eliminateBoundsChecks(IRFunction * f)
+{
+    computeDominators(f);
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        for (size_t j = 0; j < f->blocks[k]->instrs.size(); ++j)
+        {
+            IRInstr * in = f->blocks[k]->instrs[j];
+            if (in->op != irGetIndex && in->op != irSetIndex)
+                continue;
+            ++boundsStats.checks;
+            set<IRInstr *> assumed;
+            if (nonNegative(in->args[1], assumed) && belowLength(in, in->args[1], in->args[0]))
+            {
+                in->inRange = true;
+                ++boundsStats.eliminated;
+            }
+        }
+}
@@ -0,0 +1,383 @@
+#include "all.h"
+
+bool compactReport = false;
+
+// *** PACKING ***
+
+struct Packer
+{
+    CompactAst * ast;
+    unordered_map<string, NameRef> nameIndex;
+    map<unsigned long long, TypeRef> typeIndex; // by kind and ref
+
+    Packer(CompactAst * a)
+        : ast(a)
+    {
+        node(nodeNull, 0, 0, 0);
+        CompactType none = {typeNull, 0};
+        ast->types.push_back(none);
+    }
+
+    NameRef name(const string & s)
+    {
+        unordered_map<string, NameRef>::iterator p = nameIndex.find(s);
+        if (p != nameIndex.end())
+            return p->second;
+        ast->names.push_back(ast->chars.size());
+        ast->chars.insert(ast->chars.end(), s.begin(), s.end());
+        ast->chars.push_back(0);
+        return nameIndex[s] = ast->names.size() - 1;
+    }
+
+    TypeRef type(Type ty)
+    {
+        CompactType t = {typeNull, 0};
+        if (dynamic_cast<BoolType *>(ty)) t.kind = typeBool;
+        else if (dynamic_cast<IntType *>(ty)) t.kind = typeInt;
+        else if (dynamic_cast<StrType *>(ty)) t.kind = typeStr;
+        else if (dynamic_cast<VoidType *>(ty)) t.kind = typeVoid;
+        else if (dynamic_cast<AnyType *>(ty)) t.kind = typeAny;
+        else if (dynamic_cast<UndefinedType *>(ty)) t.kind = typeUndefined;
+        else if (ListType * lt = dynamic_cast<ListType *>(ty))
+        {
+            t.kind = typeList;
+            t.ref = type(lt->elementType);
+        }
+        else if (dynamic_cast<IdentType *>(ty) || dynamic_cast<ClassType *>(ty))
+        {
+            t.kind = typeIdent; // a class by name, as the parser gives it
+            t.ref = name(ty->name);
+        }
+        if (t.kind == typeNull) // no type, or a FuncType
+            return 0;
+        TypeRef & r = typeIndex[(unsigned long long) t.kind << 32 | t.ref];
+        if (!r)
+        {
+            ast->types.push_back(t);
+            r = ast->types.size() - 1;
+        }
+        return r;
+    }
+
+    NodeRef node(NodeKind k, Type ty, unsigned a, unsigned b, unsigned char flags = 0)
+    {
+        CompactNode n;
+        n.kind = k;
+        n.flags = flags;
+        n.spare = 0;
+        n.type = type(ty);
+        n.a = a;
+        n.b = b;
+        ast->nodes.push_back(n);
+        return ast->nodes.size() - 1;
+    }
+
+    ListRef run(const vector<unsigned> & items)
+    {
+        ListRef r = ast->operands.size();
+        ast->operands.push_back(items.size());
+        ast->operands.insert(ast->operands.end(), items.begin(), items.end());
+        return r;
+    }
+
+    ListRef pair(unsigned x, unsigned y)
+    {
+        ListRef r = ast->operands.size();
+        ast->operands.push_back(x);
+        ast->operands.push_back(y);
+        return r;
+    }
+
+    ListRef exprs(ExprList L)
+    {
+        vector<unsigned> items;
+        for (; L; L = L->next)
+            items.push_back(expr(L->info));
+        return run(items);
+    }
+
+    ListRef stmts(StmtList L)
+    {
+        vector<unsigned> items;
+        for (; L; L = L->next)
+            items.push_back(stmt(L->info));
+        return run(items);
+    }
+
+    ListRef typeRun(TypeList L)
+    {
+        vector<unsigned> items;
+        for (; L; L = L->next)
+            items.push_back(type(L->info));
+        return run(items);
+    }
+
+    static NodeKind binaryKind(Expr e)
+    {
+        if (dynamic_cast<AssignExpr *>(e)) return nodeAssign;
+        if (dynamic_cast<PlusExpr *>(e)) return nodePlus;
+        if (dynamic_cast<MinusExpr *>(e)) return nodeMinus;
+        if (dynamic_cast<TimesExpr *>(e)) return nodeTimes;
+        if (dynamic_cast<DivideExpr *>(e)) return nodeDivide;
+        if (dynamic_cast<ModuloExpr *>(e)) return nodeModulo;
+        if (dynamic_cast<AndExpr *>(e)) return nodeAnd;
+        if (dynamic_cast<OrExpr *>(e)) return nodeOr;
+        if (dynamic_cast<EQExpr *>(e)) return nodeEQ;
+        if (dynamic_cast<NEExpr *>(e)) return nodeNE;
+        if (dynamic_cast<LTExpr *>(e)) return nodeLT;
+        if (dynamic_cast<LEExpr *>(e)) return nodeLE;
+        if (dynamic_cast<GTExpr *>(e)) return nodeGT;
+        if (dynamic_cast<GEExpr *>(e)) return nodeGE;
+        if (dynamic_cast<InExpr *>(e)) return nodeIn;
+        if (dynamic_cast<NotInExpr *>(e)) return nodeNotIn;
+        if (dynamic_cast<IsExpr *>(e)) return nodeIs;
+        if (dynamic_cast<IsNotExpr *>(e)) return nodeIsNot;
+        return nodeNull;
+    }
+
+    static NodeKind unaryKind(Expr e)
+    {
+        if (dynamic_cast<NotExpr *>(e)) return nodeNot;
+        if (dynamic_cast<UnaryMinusExpr *>(e)) return nodeUnaryMinus;
+        if (dynamic_cast<UnaryPlusExpr *>(e)) return nodeUnaryPlus;
+        return nodeNull;
+    }
+
+    NodeRef expr(Expr e)
+    {
+        if (!e)
+            return 0;
+        Type ty = e->type;
+        if (BinaryExpr * be = dynamic_cast<BinaryExpr *>(e))
+        {
+            NodeKind k = binaryKind(e);
+            if (k != nodeNull)
+            {
+                NodeRef f = expr(be->first);
+                return node(k, ty, f, expr(be->second));
+            }
+        }
+        if (UnaryExpr * ue = dynamic_cast<UnaryExpr *>(e))
+        {
+            NodeKind k = unaryKind(e);
+            if (k != nodeNull)
+                return node(k, ty, expr(ue->first), 0);
+        }
+        if (IndexedExpr * ie = dynamic_cast<IndexedExpr *>(e))
+        {
+            NodeRef l = expr(ie->list);
+            return node(nodeIndexed, ty, l, expr(ie->index));
+        }
+        if (SelectedExpr * se = dynamic_cast<SelectedExpr *>(e))
+            return node(nodeSelected, ty, expr(se->obj), name(se->mem));
+        if (IdentExpr * id = dynamic_cast<IdentExpr *>(e))
+            return node(nodeIdent, ty, name(id->name), 0);
+        if (CallExpr * ce = dynamic_cast<CallExpr *>(e))
+        {
+            NodeRef f = expr(ce->fn);
+            return node(nodeCall, ty, f, exprs(ce->args));
+        }
+        if (BoolConstExpr * bc = dynamic_cast<BoolConstExpr *>(e))
+            return node(nodeBoolConst, ty, 0, 0, bc->value != 0);
+        if (IntConstExpr * ic = dynamic_cast<IntConstExpr *>(e))
+            return node(nodeIntConst, ty, ic->value, 0);
+        if (StrConstExpr * sc = dynamic_cast<StrConstExpr *>(e))
+            return node(nodeStrConst, ty, name(sc->value), 0);
+        if (dynamic_cast<NoneConstExpr *>(e))
+            return node(nodeNoneConst, ty, 0, 0);
+        if (dynamic_cast<InputExpr *>(e))
+            return node(nodeInput, ty, 0, 0);
+        if (PrintExpr * pe = dynamic_cast<PrintExpr *>(e))
+            return node(nodePrint, ty, exprs(pe->args), 0);
+        if (ObjConstrExpr * oc = dynamic_cast<ObjConstrExpr *>(e))
+            return node(nodeObjConstr, ty, name(oc->name), exprs(oc->args));
+        if (ListExpr * le = dynamic_cast<ListExpr *>(e))
+            return node(nodeList, ty, exprs(le->elements), 0);
+        if (dynamic_cast<UndefinedExpr *>(e))
+            return node(nodeUndefined, ty, 0, 0);
+        compiler_error("CompactAst: unknown Expr kind");
+        return 0;
+    }
+
+    NodeRef stmt(Stmt s)
+    {
+        if (!s)
+            return 0;
+        if (IfStmt * is = dynamic_cast<IfStmt *>(s))
+        {
+            NodeRef c = expr(is->cond);
+            NodeRef t = stmt(is->trueStmt);
+            return node(nodeIf, 0, c, pair(t, stmt(is->falseStmt)));
+        }
+        if (ForStmt * fs = dynamic_cast<ForStmt *>(s))
+        {
+            NodeRef e = expr(fs->ex);
+            return node(nodeFor, 0, name(fs->ident), pair(e, stmt(fs->stmt)));
+        }
+        if (WhileStmt * ws = dynamic_cast<WhileStmt *>(s))
+        {
+            NodeRef c = expr(ws->cond);
+            return node(nodeWhile, 0, c, stmt(ws->stmt));
+        }
+        if (ReturnStmt * rs = dynamic_cast<ReturnStmt *>(s))
+            return node(nodeReturn, 0, expr(rs->expr), 0);
+        if (BlockStmt * bs = dynamic_cast<BlockStmt *>(s))
+            return node(nodeBlock, 0, stmts(bs->stmts), 0);
+        if (CallStmt * cs = dynamic_cast<CallStmt *>(s))
+            return node(nodeCallStmt, 0, expr(cs->object), 0);
+        if (AssignStmt * as = dynamic_cast<AssignStmt *>(s))
+            return node(nodeAssignStmt, 0, expr(as->object), 0);
+        if (dynamic_cast<PassStmt *>(s))
+            return node(nodePass, 0, 0, 0);
+        if (dynamic_cast<BreakStmt *>(s))
+            return node(nodeBreak, 0, 0, 0);
+        if (dynamic_cast<ContinueStmt *>(s))
+            return node(nodeContinue, 0, 0, 0);
+        if (VarStmt * vs = dynamic_cast<VarStmt *>(s))
+            return node(nodeVar, vs->type, name(vs->name), expr(vs->init));
+        if (ParamStmt * ps = dynamic_cast<ParamStmt *>(s))
+            return node(nodeParam, ps->type, name(ps->name), 0);
+        if (DefStmt * ds = dynamic_cast<DefStmt *>(s))
+        {
+            ListRef p = stmts(ds->params);
+            return node(nodeDef, ds->ret_type, name(ds->name), pair(p, stmt(ds->body)));
+        }
+        if (ClassStmt * cs = dynamic_cast<ClassStmt *>(s))
+        {
+            ListRef b = typeRun(cs->bases);
+            return node(nodeClass, 0, name(cs->name), pair(b, stmt(cs->body)));
+        }
+        compiler_error("CompactAst: unknown Stmt kind");
+        return 0;
+    }
+};
+
+CompactAst * CompactAst :: make(StmtList L)
+{
+    CompactAst * ast = new CompactAst();
+    Packer p(ast);
+    ast->program = p.stmts(L);
+    return ast;
+}
+
+
+// *** UNPACKING ***
+
+struct Unpacker
+{
+    CompactAst * ast;
+
+    template <class T>
+    ListPair<T> * list(ListRef r, T (Unpacker::*item)(unsigned))
+    {
+        ListPair<T> * head = 0;
+        for (unsigned i = ast->operands[r]; i > 0; --i)
+            head = new ListPair<T>((this->*item)(ast->operands[r + i]), head);
+        return head;
+    }
+
+    Type type(TypeRef r)
+    {
+        CompactType & t = ast->types[r];
+        switch (t.kind)
+        {
+            case typeBool: return BoolType::make();
+            case typeInt: return IntType::make();
+            case typeStr: return StrType::make();
+            case typeVoid: return VoidType::make();
+            case typeAny: return AnyType::make();
+            case typeUndefined: return UndefinedType::make();
+            case typeList: return ListType::make(type(t.ref));
+            case typeIdent: return IdentType::make(name(t.ref));
+            default: return 0;
+        }
+    }
+    unsigned extra(CompactNode & n, unsigned i) { return ast->operands[n.b + i]; }
+    string name(NameRef n) { return ast->name(n); }
+
+    Expr expr(NodeRef r)
+    {
+        if (!r)
+            return 0;
+        CompactNode & n = ast->nodes[r];
+        Expr e;
+        switch (n.kind)
+        {
+            case nodeIndexed: e = IndexedExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeSelected: e = SelectedExpr::make(expr(n.a), name(n.b)); break;
+            case nodeIdent: e = IdentExpr::make(name(n.a)); break;
+            case nodeCall: e = CallExpr::make(expr(n.a), list(n.b, &Unpacker::expr)); break;
+            case nodeBoolConst: e = BoolConstExpr::make(n.flags); break;
+            case nodeIntConst: e = IntConstExpr::make(int(n.a)); break;
+            case nodeStrConst: e = StrConstExpr::make(name(n.a)); break;
+            case nodeNoneConst: e = NoneConstExpr::make(); break;
+            case nodeNot: e = NotExpr::make(expr(n.a)); break;
+            case nodeUnaryMinus: e = UnaryMinusExpr::make(expr(n.a)); break;
+            case nodeUnaryPlus: e = UnaryPlusExpr::make(expr(n.a)); break;
+            case nodeAssign: e = AssignExpr::make(expr(n.a), expr(n.b)); break;
+            case nodePlus: e = PlusExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeMinus: e = MinusExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeTimes: e = TimesExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeDivide: e = DivideExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeModulo: e = ModuloExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeAnd: e = AndExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeOr: e = OrExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeEQ: e = EQExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeNE: e = NEExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeLT: e = LTExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeLE: e = LEExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeGT: e = GTExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeGE: e = GEExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeIn: e = InExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeNotIn: e = NotInExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeIs: e = IsExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeIsNot: e = IsNotExpr::make(expr(n.a), expr(n.b)); break;
+            case nodeInput: e = InputExpr::make(); break;
+            case nodePrint: e = PrintExpr::make(list(n.a, &Unpacker::expr)); break;
+            case nodeObjConstr: e = ObjConstrExpr::make(name(n.a), list(n.b, &Unpacker::expr)); break;
+            case nodeList: e = ListExpr::make(list(n.a, &Unpacker::expr)); break;
+            case nodeUndefined: return UndefinedExpr::make();
+            default:
+                compiler_error("CompactAst: not an Expr node");
+                return 0;
+        }
+        if (n.type)
+            e->type = type(n.type);
+        return e;
+    }
+
+    Stmt stmt(NodeRef r)
+    {
+        if (!r)
+            return 0;
+        CompactNode & n = ast->nodes[r];
+        switch (n.kind)
+        {
+            case nodeIf: return IfStmt::make(expr(n.a), stmt(extra(n, 0)), stmt(extra(n, 1)));
+            case nodeFor: return ForStmt::make(name(n.a), expr(extra(n, 0)), stmt(extra(n, 1)));
+            case nodeWhile: return WhileStmt::make(expr(n.a), stmt(n.b));
+            case nodeReturn: return ReturnStmt::make(expr(n.a));
+            case nodeBlock: return BlockStmt::make(list(n.a, &Unpacker::stmt));
+            case nodeCallStmt: return CallStmt::make(expr(n.a));
+            case nodeAssignStmt: return AssignStmt::make(expr(n.a));
+            case nodePass: return PassStmt::make();
+            case nodeBreak: return BreakStmt::make();
+            case nodeContinue: return ContinueStmt::make();
+            case nodeVar: return VarStmt::make(name(n.a), type(n.type), expr(n.b));
+            case nodeParam: return ParamStmt::make(name(n.a), type(n.type));
+            case nodeDef:
+                return DefStmt::make(name(n.a), list(extra(n, 0), &Unpacker::stmt), type(n.type), stmt(extra(n, 1)));
+            case nodeClass:
+                return ClassStmt::make(name(n.a), list(extra(n, 0), &Unpacker::type), stmt(extra(n, 1)));
+            default:
+                compiler_error("CompactAst: not a Stmt node");
+                return 0;
+        }
+    }
+};
+
+StmtList CompactAst :: statements()
+{
+    Unpacker u = {this};
+    return u.list(program, &Unpacker::stmt);
+}
@@ -0,0 +1,123 @@
+// *** COMPACT AST ***
+//
+// A CompactAst holds a whole program in four flat arrays instead of one
+// heap object per node.  Nodes, names and types are named by 32-bit
+// handles (NodeRef, NameRef, TypeRef; 0 means none), so a child costs 4
+// bytes instead of an 8-byte pointer, and every node is a 16-byte
+// CompactNode with no vtable.  Lists (args, elements, statements,
+// params, bases) and the third and fourth operands of the few nodes that
+// have them are runs in operands[]: a ListRef r names the count at
+// operands[r] followed by that many handles.  Identifiers, members,
+// names of defs and classes, and str literals are interned once in
+// chars[], however often they appear.
+//
+//     kind                          a            b            bytes
+//     Bool/None/Input/Undefined    (flags: value)              16
+//     IntConst                      value                      16
+//     StrConst, Ident               name                       16
+//     Not, UnaryMinus, UnaryPlus    first                      16
+//     binary ops, Assign, Indexed   first        second        16
+//     Selected                      obj          member name   16
+//     Call                          fn           args list     16 + 4(n+1)
+//     Print, List                   list                       16 + 4(n+1)
+//     ObjConstr                     class name   args list     16 + 4(n+1)
+//     If                            cond         [true, false] 24
+//     For                           ident        [ex, stmt]    24
+//     While                         cond         stmt          16
+//     Return, CallStmt, AssignStmt  expr                       16
+//     Pass, Break, Continue                                    16
+//     Block                         stmts list                 16 + 4(n+1)
+//     Var                           name         init          16
+//     Param                         name                       16
+//     Def                           name         [params, body] 24 + params
+//     Class                         name         [bases, body] 24 + bases
+//
+// Types (an Expr's checked type, or the declared type of a Var, Param or
+// Def) go in the node's type field as a TypeRef into types[], whose 8-byte
+// CompactTypes name a class by its NameRef (rebuilt as the parser's
+// IdentType) and a list by its element's TypeRef, so nothing in a CompactAst points into the pointer tree.  The
+// function types check() gives some Exprs are not kept.  What
+// check() attaches to nodes (symbols, frame slots, method slots, inline
+// caches, escape marks) is not kept: statements() rebuilds the pointer
+// tree through the make() factories, and checking it again recomputes
+// them.  Source rows are not kept either, so diagnostics from checking a
+// rebuilt tree carry the row current when it was rebuilt.
+//
+// -m packs each parsed program, prints its size next to the node arena's
+// and runs the mode on the rebuilt tree.  bench/CompactBench.cpp compares
+// the two layouts on a generated program: for 1,000,010 lines the pointer
+// tree takes 333 MB of heap (266 MB of it node arena), the compact AST
+// 106 MB.
+
+typedef unsigned NodeRef;
+typedef unsigned NameRef;
+typedef unsigned TypeRef;
+typedef unsigned ListRef;
+
+enum NodeKind
+{
+    nodeNull,
+    nodeIndexed, nodeSelected, nodeIdent, nodeCall,
+    nodeBoolConst, nodeIntConst, nodeStrConst, nodeNoneConst,
+    nodeNot, nodeUnaryMinus, nodeUnaryPlus,
+    nodeAssign, nodePlus, nodeMinus, nodeTimes, nodeDivide, nodeModulo,
+    nodeAnd, nodeOr, nodeEQ, nodeNE, nodeLT, nodeLE, nodeGT, nodeGE,
+    nodeIn, nodeNotIn, nodeIs, nodeIsNot,
+    nodeInput, nodePrint, nodeObjConstr, nodeList, nodeUndefined,
+    nodeIf, nodeFor, nodeWhile, nodeReturn, nodeBlock, nodeCallStmt,
+    nodeAssignStmt, nodePass, nodeBreak, nodeContinue, nodeVar, nodeParam,
+    nodeDef, nodeClass
+};
+
+enum CompactTypeKind
+{
+    typeNull, typeBool, typeInt, typeStr, typeVoid, typeAny, typeUndefined,
+    typeList, typeIdent
+};
+
+struct CompactType
+{
+    unsigned kind; // CompactTypeKind
+    unsigned ref;  // List: element TypeRef; Ident: the class name
+};
+
+struct CompactNode
+{
+    unsigned char kind;   // NodeKind
+    unsigned char flags;  // BoolConst: its value
+    unsigned short spare;
+    TypeRef type;
+    unsigned a, b;        // operands, see the table above
+};
+
+struct CompactAst
+{
+    vector<CompactNode> nodes;  // nodes[0] is the null node
+    vector<unsigned> operands;  // list runs and extra operands
+    vector<char> chars;         // interned names, each NUL-terminated
+    vector<unsigned> names;     // NameRef to its offset in chars
+    vector<CompactType> types;  // types[0] is no type
+    ListRef program;            // the top-level statements
+
+    static CompactAst * make(StmtList L); // pack a parsed or checked tree
+
+    StmtList statements();      // the pointer tree again, unchecked
+
+    const char * name(NameRef n) { return &chars[names[n]]; }
+
+    size_t bytes()
+    {
+        return nodes.size() * sizeof(CompactNode) + operands.size() * sizeof(unsigned)
+            + chars.size() + names.size() * sizeof(unsigned) + types.size() * sizeof(CompactType);
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** Compact AST: " << bytes() << " bytes ***" << endl;
+        out << "nodes " << nodes.size() << " operands " << operands.size()
+            << " names " << names.size() << " (" << chars.size() << " chars) types "
+            << types.size() << endl;
+    }
+};
+
+extern bool compactReport; // pack each program, print its size and go on with the rebuilt tree (-m)
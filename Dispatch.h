@@ -0,0 +1,70 @@
+// *** METHOD DISPATCH ***
+//
+// A method call obj.m(...) whose receiver has a class as its static type
+// is bound to m's index in that class's method table and dispatches with
+// one load from the receiver's table.  Calls on any-typed receivers, and
+// on classes whose indices a subclass could not keep, go through an inline
+// cache at the call site remembering up to WAYS receiver classes.
+
+struct InlineCache
+{
+    enum { WAYS = 4 };
+
+    string name;
+    ClassType * classes[WAYS];
+    Symbol targets[WAYS];
+    int size;
+    long hits, misses;
+
+    InlineCache(string nm)
+        : name(nm), size(0), hits(0), misses(0)
+    {
+    }
+
+    bool isMegamorphic() { return size == WAYS && misses > size; }
+
+    Symbol lookup(ClassType * cls)
+    {
+        for (int i = 0; i < size; ++i)
+            if (classes[i] == cls)
+            {
+                ++hits;
+                return targets[i];
+            }
+        ++misses;
+        int k = cls->methodIndex(name);
+        Symbol target = k < 0 ? 0 : cls->methods[k];
+        if (size < WAYS)
+        {
+            classes[size] = cls;
+            targets[size++] = target;
+        }
+        return target;
+    }
+};
+
+// Done once per call site, after check() has typed its receiver.
+inline void bindMethodCall(CallExpr * ce)
+{
+    SelectedExpr * se = dynamic_cast<SelectedExpr *>(ce->fn);
+    if (!se || !se->obj->type)
+        return;
+    ClassType * ct = dynamic_cast<ClassType *>(se->obj->type->rootType(se->obj->type));
+    if (ct)
+    {
+        ce->receiverClass = ct;
+        ce->methodIndex = ct->methodIndex(se->mem);
+    }
+    if (ce->methodIndex < 0 && !ce->cache)
+        ce->cache = new InlineCache(se->mem);
+}
+
+// The FuncSymbol to run for a bound call on an instance of cls.
+inline Symbol dispatchMethod(CallExpr * ce, ClassType * cls)
+{
+    if (ce->methodIndex >= 0 && !ce->receiverClass->unstableIndices)
+        return cls->methods[ce->methodIndex];
+    if (!ce->cache)
+        ce->cache = new InlineCache(static_cast<SelectedExpr *>(ce->fn)->mem);
+    return ce->cache->lookup(cls);
+}
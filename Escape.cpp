@@ -0,0 +1,246 @@
+#include "all.h"
+
+EscapeStats escapeStats;
+bool escapeReport = false;
+
+struct EscapeAnalysis
+{
+    map<string, ObjConstrExpr *> fresh; // candidate locals and their allocation
+    set<string> escaped;
+    int nested; // > 0 inside a nested def or class
+
+    EscapeAnalysis()
+        : nested(0)
+    {
+    }
+
+    void escape(string name)
+    {
+        escaped.insert(name);
+    }
+
+    void exprs(ExprList L)
+    {
+        for (; L; L = L->next)
+            expr(L->info);
+    }
+
+    // e is used as a value: any candidate it names escapes
+    void expr(Expr e)
+    {
+        if (!e)
+            return;
+        if (IdentExpr * id = dynamic_cast<IdentExpr *>(e))
+            escape(id->name);
+        else if (SelectedExpr * se = dynamic_cast<SelectedExpr *>(e))
+            object(se->obj);
+        else if (CallExpr * ce = dynamic_cast<CallExpr *>(e))
+        {
+            if (SelectedExpr * m = dynamic_cast<SelectedExpr *>(ce->fn))
+                expr(m->obj); // receiver is passed as self
+            else
+                expr(ce->fn);
+            exprs(ce->args);
+        }
+        else if (AssignExpr * ae = dynamic_cast<AssignExpr *>(e))
+        {
+            target(ae->first);
+            expr(ae->second);
+        }
+        else if (RelationalExpr * re = dynamic_cast<RelationalExpr *>(e))
+        {
+            object(re->first); // comparing stores nothing
+            object(re->second);
+        }
+        else if (BinaryExpr * be = dynamic_cast<BinaryExpr *>(e))
+        {
+            expr(be->first);
+            expr(be->second);
+        }
+        else if (UnaryExpr * ue = dynamic_cast<UnaryExpr *>(e))
+            expr(ue->first);
+        else if (IndexedExpr * ie = dynamic_cast<IndexedExpr *>(e))
+        {
+            expr(ie->list);
+            expr(ie->index);
+        }
+        else if (ObjConstrExpr * oe = dynamic_cast<ObjConstrExpr *>(e))
+            exprs(oe->args);
+        else if (ListExpr * le = dynamic_cast<ListExpr *>(e))
+            exprs(le->elements);
+        else if (PrintExpr * pe = dynamic_cast<PrintExpr *>(e))
+            exprs(pe->args);
+    }
+
+    // e is only dereferenced or compared
+    void object(Expr e)
+    {
+        if (dynamic_cast<IdentExpr *>(e) && !nested)
+            return;
+        expr(e);
+    }
+
+    void target(Expr e)
+    {
+        if (IdentExpr * id = dynamic_cast<IdentExpr *>(e))
+            escape(id->name); // no longer the only name for its object
+        else if (SelectedExpr * se = dynamic_cast<SelectedExpr *>(e))
+            object(se->obj);
+        else
+            expr(e);
+    }
+
+    void stmts(StmtList L)
+    {
+        for (; L; L = L->next)
+            stmt(L->info);
+    }
+
+    void stmt(Stmt s)
+    {
+        if (!s)
+            return;
+        if (VarStmt * vs = dynamic_cast<VarStmt *>(s))
+        {
+            ObjConstrExpr * oe = dynamic_cast<ObjConstrExpr *>(vs->init);
+            if (oe && !nested && !fresh.count(vs->name))
+                fresh[vs->name] = oe;
+            else
+                escape(vs->name); // redeclared, or not a fresh object
+            expr(vs->init);
+        }
+        else if (AssignStmt * as = dynamic_cast<AssignStmt *>(s))
+            expr(as->object);
+        else if (CallStmt * cs = dynamic_cast<CallStmt *>(s))
+            expr(cs->object);
+        else if (ReturnStmt * rs = dynamic_cast<ReturnStmt *>(s))
+            expr(rs->expr);
+        else if (IfStmt * is = dynamic_cast<IfStmt *>(s))
+        {
+            expr(is->cond);
+            stmt(is->trueStmt);
+            stmt(is->falseStmt);
+        }
+        else if (WhileStmt * ws = dynamic_cast<WhileStmt *>(s))
+        {
+            expr(ws->cond);
+            stmt(ws->stmt);
+        }
+        else if (ForStmt * fs = dynamic_cast<ForStmt *>(s))
+        {
+            escape(fs->ident);
+            expr(fs->ex);
+            stmt(fs->stmt);
+        }
+        else if (BlockStmt * bs = dynamic_cast<BlockStmt *>(s))
+            stmts(bs->stmts);
+        else if (DefStmt * ds = dynamic_cast<DefStmt *>(s))
+        {
+            ++nested;
+            stmt(ds->body);
+            --nested;
+        }
+        else if (ClassStmt * cls = dynamic_cast<ClassStmt *>(s))
+        {
+            ++nested;
+            stmt(cls->body);
+            --nested;
+        }
+    }
+};
+
+// The classes of the program, by name, and whether each one's __init__
+// lets self escape.
+struct ClassInits
+{
+    map<string, ClassStmt *> classes;
+    map<string, bool> leaks;
+
+    void collect(Stmt s)
+    {
+        if (ClassStmt * cls = dynamic_cast<ClassStmt *>(s))
+            classes[cls->name] = cls;
+        else if (DefStmt * def = dynamic_cast<DefStmt *>(s))
+            collect(def->body);
+        else if (BlockStmt * bs = dynamic_cast<BlockStmt *>(s))
+            for (StmtList p = bs->stmts; p; p = p->next)
+                collect(p->info);
+    }
+
+    // The __init__ new name(...) runs: the class's own, else the first
+    // found through its bases, depth first.
+    DefStmt * constructor(const string & name, set<string> & seen)
+    {
+        if (!classes.count(name) || !seen.insert(name).second)
+            return 0;
+        ClassStmt * cls = classes[name];
+        DefStmt * def = dynamic_cast<DefStmt *>(cls->body);
+        if (def && def->name == CONSTRUCTOR_NAME)
+            return def;
+        BlockStmt * body = dynamic_cast<BlockStmt *>(cls->body);
+        for (StmtList p = body ? body->stmts : 0; p; p = p->next)
+            if ((def = dynamic_cast<DefStmt *>(p->info)) && def->name == CONSTRUCTOR_NAME)
+                return def;
+        for (TypeList b = cls->bases; b; b = b->next)
+            if (DefStmt * def = constructor(b->info->name, seen))
+                return def;
+        return 0;
+    }
+
+    bool leaksSelf(const string & name)
+    {
+        map<string, bool>::iterator p = leaks.find(name);
+        if (p != leaks.end())
+            return p->second;
+        set<string> seen;
+        DefStmt * init = constructor(name, seen);
+        ParamStmt * self = init && init->params ? dynamic_cast<ParamStmt *>(init->params->info) : 0;
+        bool leak = false;
+        if (self)
+        {
+            EscapeAnalysis ea;
+            ea.stmt(init->body);
+            leak = ea.escaped.count(self->name) > 0;
+        }
+        return leaks[name] = leak;
+    }
+};
+
+static void analyzeEscapes(DefStmt * def, ClassInits & inits)
+{
+    EscapeAnalysis ea;
+    ea.stmt(def->body);
+    ++escapeStats.functions;
+    for (map<string, ObjConstrExpr *>::iterator it = ea.fresh.begin(); it != ea.fresh.end(); ++it)
+    {
+        ++escapeStats.allocations;
+        if (!ea.escaped.count(it->first) && !inits.leaksSelf(it->second->name))
+        {
+            it->second->inFrame = true;
+            ++escapeStats.stackAllocated;
+        }
+    }
+}
+
+static void analyzeEscapes(Stmt s, ClassInits & inits)
+{
+    if (DefStmt * def = dynamic_cast<DefStmt *>(s))
+    {
+        analyzeEscapes(def, inits);
+        analyzeEscapes(def->body, inits); // nested defs get their own frames
+    }
+    else if (ClassStmt * cls = dynamic_cast<ClassStmt *>(s))
+        analyzeEscapes(cls->body, inits);
+    else if (BlockStmt * bs = dynamic_cast<BlockStmt *>(s))
+        for (StmtList p = bs->stmts; p; p = p->next)
+            analyzeEscapes(p->info, inits);
+}
+
+void analyzeEscapes(StmtList L)
+{
+    ClassInits inits;
+    for (StmtList p = L; p; p = p->next)
+        inits.collect(p->info);
+    for (; L; L = L->next)
+        analyzeEscapes(L->info, inits);
+}
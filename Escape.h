@@ -0,0 +1,35 @@
+// *** ESCAPE ANALYSIS ***
+//
+// Finds class instances created in a def body that never leave it.  A
+// local initialized by an ObjConstrExpr does not escape while it is only
+// used as the object of a field access; passing it to a call (including
+// its own methods and print), storing it into a list, a field or another
+// variable, returning it, reassigning it or naming it in a nested def all
+// make it escape.  So does an object whose class's __init__, its own or
+// the one it inherits, lets self escape in the same sense.  Non-escaping
+// ObjConstrExprs are marked inFrame and can be allocated in the
+// function's frame instead of by malloc.
+
+struct EscapeStats
+{
+    int functions;      // def bodies analyzed
+    int allocations;    // ObjConstrExprs bound to locals
+    int stackAllocated; // of those, marked inFrame
+
+    EscapeStats()
+        : functions(0), allocations(0), stackAllocated(0)
+    {
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** Escape Analysis ***" << endl;
+        out << "functions " << functions << " local allocations " << allocations
+            << " stack allocated " << stackAllocated << endl;
+    }
+};
+
+extern EscapeStats escapeStats;
+extern bool escapeReport; // print escapeStats after checking (-e)
+
+void analyzeEscapes(StmtList L); // every def, including methods, in program L
@@ -0,0 +1,437 @@
+#include "all.h"
+
+// A call's frame, registered with the heap and the profiler while it runs.
+struct ActiveFrame
+{
+    Executor & x;
+
+    ActiveFrame(Executor & ex, vector<Value> & slots, ExecFunction & f, int row)
+        : x(ex)
+    {
+        if (x.depth >= Executor::MAX_DEPTH)
+            runtime_trap("recursion too deep");
+        ++x.depth;
+        heap().pushFrame(slots.data(), slots.size(), &f.stackMap);
+        if (x.profiling)
+            profiler().enter(f.site, row);
+    }
+
+    ~ActiveFrame()
+    {
+        if (x.profiling)
+            profiler().exit();
+        heap().popFrame();
+        --x.depth;
+    }
+};
+
+Executor :: Executor(IRModule * m)
+    : module(m), depth(0), profiling(profiler().enabled())
+{
+    for (size_t i = 0; i < m->functions.size(); ++i)
+    {
+        IRFunction * f = m->functions[i];
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+            for (size_t j = 0; j < f->blocks[k]->instrs.size(); ++j)
+            {
+                IRInstr * in = f->blocks[k]->instrs[j];
+                if ((in->op == irGLoad || in->op == irGStore) && !globalSlots.count(in->name))
+                {
+                    size_t slot = globalSlots.size();
+                    globalSlots[in->name] = slot;
+                }
+            }
+    }
+    globals.resize(globalSlots.size());
+    defined.resize(globalSlots.size());
+    heap().pushFrame(globals.data(), globals.size());
+}
+
+Executor :: ~Executor()
+{
+    heap().popFrame();
+}
+
+// On the first call of f.  Values the IR proves int or bool hold no
+// pointer and are left out of the stack map.  A param's declared type
+// proves nothing: an any holding a list may be passed for an int.
+ExecFunction & Executor :: prepare(IRFunction * f)
+{
+    map<IRFunction *, ExecFunction>::iterator p = functions.find(f);
+    if (p != functions.end())
+        return p->second;
+    ExecFunction & ef = functions[f];
+    ef.site = profiler().siteFor(f->name);
+    bool jit = !profiling && jitThreshold > 0 && f->params.size() <= 6;
+    for (size_t i = 0; i < f->params.size(); ++i)
+        jit = jit && f->params[i]->type && !f->params[i]->type->behavior(isAny)
+            && (f->params[i]->type->behavior(isInt) || f->params[i]->type->behavior(isBool));
+    if (jit)
+        ef.jit = new JitEntry(f);
+    int blocks = 0;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        blocks = max(blocks, f->blocks[k]->id + 1);
+    ef.quick.resize(blocks);
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        ef.quick[f->blocks[k]->id].resize(f->blocks[k]->instrs.size());
+    StackMap & s = ef.stackMap;
+    s.pointerSlots.assign(f->nextValue, true);
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        for (size_t j = 0; j < f->blocks[k]->instrs.size(); ++j)
+        {
+            IRInstr * in = f->blocks[k]->instrs[j];
+            if (in->id < 0 || in->id >= f->nextValue)
+                continue;
+            switch (in->op)
+            {
+                case irConst: case irSub: case irDiv: case irMod: case irNeg: case irNot:
+                case irEQ: case irNE: case irLT: case irLE: case irGT: case irGE:
+                case irIs: case irIsNot: case irIn: case irNotIn: case irLen: case irAddImm:
+                    s.pointerSlots[in->id] = false;
+                    break;
+                default:
+                    break;
+            }
+        }
+    return ef;
+}
+
+void Executor :: addInitializers(const string & cls, vector<IRFunction *> & defs, set<string> & seen)
+{
+    if (!seen.insert(cls).second)
+        return;
+    vector<string> & bases = module->bases[cls];
+    for (size_t i = bases.size(); i-- > 0; ) // the first base's initializers run last
+        addInitializers(bases[i], defs, seen);
+    map<string, IRFunction *>::iterator f = module->byName.find(cls + "." + FIELDS_NAME);
+    if (f != module->byName.end())
+        defs.push_back(f->second);
+}
+
+ClassType * Executor :: classFor(const string & name)
+{
+    ClassType *& c = classes[name];
+    if (!c)
+    {
+        c = static_cast<ClassType *>(ClassType::make(0));
+        c->name = name;
+        set<string> seen;
+        addInitializers(name, initializers[name], seen);
+    }
+    return c;
+}
+
+Value Executor :: call(IRFunction * f, const vector<Value> & args)
+{
+    if (args.size() != f->params.size())
+        runtime_trap(f->name + " takes " + to_string(f->params.size()) + " arguments");
+    ExecFunction & ef = prepare(f);
+    if (ef.jit)
+    {
+        Int a[6];
+        bool immediate = true;
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            immediate = immediate && (args[i].isInt() || args[i].isBool());
+            a[i] = args[i].isInt() ? args[i].asInt() : args[i].asBool();
+        }
+        Int result;
+        if (immediate && ef.jit->run(a, result) && result != JIT_OVERFLOW)
+            return ef.jit->returnsBool ? Value::fromBool(result) : Value::fromInt(result);
+    }
+    vector<Value> v(f->nextValue);
+    for (size_t i = 0; i < args.size(); ++i)
+        v[f->params[i]->id] = args[i];
+    IRInstr * first = f->blocks[0]->instrs.empty() ? 0 : f->blocks[0]->instrs[0];
+    ActiveFrame frame(*this, v, ef, first ? first->row : -1);
+    return execute(f, ef, v);
+}
+
+void Executor :: run()
+{
+    map<string, IRFunction *>::iterator f = module->byName.find(MAIN_NAME);
+    if (f != module->byName.end())
+        call(f->second, vector<Value>());
+}
+
+static bool truthy(Value v)
+{
+    if (v.isBool())
+        return v.asBool();
+    if (v.isInt())
+        return v.asInt() != 0;
+    if (v.isNone())
+        return false;
+    if (isStrValue(v))
+        return strLength(v) > 0;
+    if (v.asObject()->kind == instanceObj)
+        return true;
+    return listLength(v.asObject()) > 0;
+}
+
+static Int intOperand(Value v, const char * op)
+{
+    if (isNumber(v))
+        return numberValue(v);
+    runtime_trap(string("unsupported operand type for ") + op);
+}
+
+static InstanceObject * instanceOperand(Value v)
+{
+    if (!v.isObject() || v.asObject()->kind != instanceObj)
+        runtime_trap("attribute of a value that is not an object");
+    return static_cast<InstanceObject *>(v.asObject());
+}
+
+// Python's floor division and modulo.
+static Int floorDiv(Int a, Int b)
+{
+    if (b == 0)
+        runtime_trap("division by zero");
+    Int q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+static Int floorMod(Int a, Int b)
+{
+    if (b == 0)
+        runtime_trap("division by zero");
+    Int r = a % b;
+    return (r != 0 && (r < 0) != (b < 0)) ? r + b : r;
+}
+
+static bool contains(Value container, Value x)
+{
+    if (isListValue(container))
+        return listContains(container.asObject(), x);
+    if (isStrValue(container) && isStrValue(x))
+        return strString(container).find(strString(x)) != string::npos;
+    runtime_trap("in on a value that is neither a list nor a str");
+}
+
+// new C / alloc C: the object, with the attribute initializers of C and
+// its bases run, and for new then C's __init__.
+Value Executor :: instantiate(IRInstr * in, vector<Value> & v)
+{
+    ClassType * c = classFor(in->name);
+    Value & self = v[in->id];
+    self = Value::fromObject(gcNew<InstanceObject>(c, c->fields.size()));
+    vector<IRFunction *> & init = initializers[in->name];
+    for (size_t i = 0; i < init.size(); ++i)
+        call(init[i], vector<Value>(1, self));
+    if (in->op == irNew)
+    {
+        vector<Value> args(1, self); // re-read: the initializers may have moved it
+        for (size_t i = 0; i < in->args.size(); ++i)
+            args.push_back(v[in->args[i]->id]);
+        if (IRFunction * ctor = module->constructorFor(in->name))
+            call(ctor, args);
+        else if (!in->args.empty())
+            runtime_trap(in->name + " takes no arguments");
+    }
+    return self;
+}
+
+Value Executor :: execute(IRFunction * f, ExecFunction & ef, vector<Value> & v)
+{
+    IRBlock * from = 0;
+    IRBlock * b = f->blocks[0];
+    IRInstr * in = 0;
+    int row = -1; // last given to the profiler
+    vector<Value> args, phis;
+    try
+    {
+        for (;;)
+        {
+            size_t i = 0;
+            if (from) // the phis read their inputs before any is written
+            {
+                phis.clear();
+                for (; i < b->instrs.size() && b->instrs[i]->op == irPhi; ++i)
+                {
+                    in = b->instrs[i];
+                    size_t k = find(in->targets.begin(), in->targets.end(), from) - in->targets.begin();
+                    phis.push_back(k < in->args.size() ? v[in->args[k]->id] : Value());
+                }
+                for (size_t k = 0; k < phis.size(); ++k)
+                    v[b->instrs[k]->id] = phis[k];
+            }
+            IRBlock * next = 0;
+            for (; !next; ++i)
+            {
+                if (i == b->instrs.size())
+                    runtime_trap("block " + to_string(b->id) + " of " + f->name + " has no terminator");
+                in = b->instrs[i];
+                if (profiling && in->row != row)
+                    profiler().setRow(row = in->row);
+                Value * a = in->args.empty() ? 0 : &v[in->args[0]->id];
+                Value * c = in->args.size() < 2 ? 0 : &v[in->args[1]->id];
+                Value r;
+                switch (in->op)
+                {
+                    case irConst:
+                        r = in->type && in->type->behavior(isBool)
+                            ? Value::fromBool(in->imm) : Value::fromInt(in->imm);
+                        break;
+                    case irStr: r = makeStr(in->name); break;
+                    case irNone: break;
+                    case irParam: case irPhi: continue; // placed by call() and on entry
+                    case irAdd: r = quickAdd(ef.quick[b->id][i], *a, *c); break;
+                    case irAddImm: r = Value::fromInt(intOperand(*a, "+") + in->imm); break;
+                    case irSub: r = Value::fromInt(intOperand(*a, "-") - intOperand(*c, "-")); break;
+                    case irMul:
+                    {
+                        Int p;
+                        if (__builtin_mul_overflow(intOperand(*a, "*"), intOperand(*c, "*"), &p))
+                            runtime_trap("int out of range");
+                        r = Value::fromInt(p);
+                        break;
+                    }
+                    case irDiv: r = Value::fromInt(floorDiv(intOperand(*a, "/"), intOperand(*c, "/"))); break;
+                    case irMod: r = Value::fromInt(floorMod(intOperand(*a, "%"), intOperand(*c, "%"))); break;
+                    case irNeg: r = Value::fromInt(-intOperand(*a, "-")); break;
+                    case irNot: r = Value::fromBool(!truthy(*a)); break;
+                    case irEQ: case irNE: case irLT: case irLE: case irGT: case irGE:
+                        r = Value::fromBool(quickCompare(ef.quick[b->id][i], in->op, *a, *c));
+                        break;
+                    case irIs: r = Value::fromBool(*a == *c); break;
+                    case irIsNot: r = Value::fromBool(*a != *c); break;
+                    case irIn: r = Value::fromBool(contains(*c, *a)); break;
+                    case irNotIn: r = Value::fromBool(!contains(*c, *a)); break;
+                    case irLen:
+                        if (isListValue(*a))
+                            r = Value::fromInt(listLength(a->asObject()));
+                        else if (isStrValue(*a))
+                            r = Value::fromInt(strLength(*a));
+                        else
+                            runtime_trap("len of a value that is neither a list nor a str");
+                        break;
+                    case irGetIndex: r = quickGetIndex(ef.quick[b->id][i], *a, *c); break;
+                    case irSetIndex:
+                        if (!isListValue(*a))
+                            runtime_trap("index store into a value that is not a list");
+                        listSet(a->asObject(), intOperand(*c, "an index"), v[in->args[2]->id]);
+                        continue;
+                    case irGetField:
+                    {
+                        InstanceObject * o = instanceOperand(*a);
+                        int k = o->cls->fieldIndex(in->name);
+                        if (k < 0 || (size_t) k >= o->fields.size())
+                            runtime_trap(o->cls->name + " object has no attribute " + in->name);
+                        r = o->fields[k];
+                        break;
+                    }
+                    case irSetField:
+                    {
+                        InstanceObject * o = instanceOperand(*a);
+                        int k = o->cls->fieldIndex(in->name);
+                        if (k < 0)
+                        {
+                            Symbol sy = VarSymbol::make(in->name, 0);
+                            sy->depth = -1;
+                            sy->slot = k = o->cls->fields.size();
+                            o->cls->fields.push_back(sy);
+                        }
+                        if ((size_t) k >= o->fields.size())
+                            o->fields.resize(k + 1);
+                        instanceSet(o, k, *c);
+                        continue;
+                    }
+                    case irGLoad:
+                    {
+                        size_t k = globalSlot(in->name);
+                        if (!defined[k])
+                            runtime_trap("name " + in->name + " is not defined");
+                        r = globals[k];
+                        break;
+                    }
+                    case irGStore:
+                    {
+                        size_t k = globalSlot(in->name);
+                        globals[k] = *a;
+                        defined[k] = true;
+                        continue;
+                    }
+                    case irList:
+                    {
+                        v[in->id] = Value::fromObject(makeList(in->type));
+                        for (size_t k = 0; k < in->args.size(); ++k)
+                            listAppend(v[in->id].asObject(), v[in->args[k]->id]);
+                        continue;
+                    }
+                    case irNew: case irAlloc: instantiate(in, v); continue;
+                    case irCall: case irCallMethod:
+                    {
+                        IRFunction * callee = 0;
+                        if (in->op == irCallMethod)
+                        {
+                            InstanceObject * o = instanceOperand(*a);
+                            callee = module->methodFor(o->cls->name, in->name);
+                            if (!callee)
+                                runtime_trap(o->cls->name + " object has no method " + in->name);
+                        }
+                        else if (in->name.empty())
+                            runtime_trap("call through a value is not supported");
+                        else if (module->qualified)
+                        {
+                            map<string, IRFunction *>::iterator p = module->byName.find(in->name);
+                            callee = p == module->byName.end() ? 0 : p->second;
+                        }
+                        else
+                            callee = module->functionFor(f->name, in->name);
+                        if (!callee)
+                            runtime_trap("no def named " + in->name);
+                        args.clear();
+                        for (size_t k = 0; k < in->args.size(); ++k)
+                            args.push_back(v[in->args[k]->id]);
+                        r = call(callee, args);
+                        break;
+                    }
+                    case irPrint:
+                        args.clear();
+                        for (size_t k = 0; k < in->args.size(); ++k)
+                            args.push_back(v[in->args[k]->id]);
+                        runtimePrint(args.data(), args.size());
+                        break;
+                    case irPrintStr:
+                        runtimeOut().put(in->name.data(), in->name.size());
+                        runtimeOut().put('\n');
+                        continue;
+                    case irInput: r = keepInput(runtimeInput()); break;
+                    case irBr: next = in->targets[0]; continue;
+                    case irCbr: next = in->targets[truthy(*a) ? 0 : 1]; continue;
+                    case irCmpBr: next = in->targets[quickCompare(ef.quick[b->id][i], IROp(in->imm), *a, *c) ? 0 : 1];
+                        continue;
+                    case irRet: return a ? *a : Value();
+                }
+                if (in->id >= 0)
+                    v[in->id] = r;
+            }
+            from = b;
+            b = next;
+        }
+    }
+    catch (RuntimeTrap & t)
+    {
+        if (t.row < 0 && in)
+            t.row = in->row; // the innermost frame knows where it stopped
+        throw;
+    }
+}
+
+bool runProgram(IRModule * m)
+{
+    Executor x(m);
+    try
+    {
+        x.run();
+    }
+    catch (RuntimeTrap & t)
+    {
+        runtimeOut().flush();
+        diagnostics().report(runtimeError, t.row, t.message);
+        return false;
+    }
+    runtimeOut().flush();
+    return true;
+}
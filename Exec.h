@@ -0,0 +1,71 @@
+// *** IR EXECUTOR ***
+//
+// runProgram runs a compiled IRModule (-6): the def MAIN_NAME, and from
+// it every def, method and constructor the program calls.  Each call gets
+// a frame of Values, one per IR value id, registered with the heap as a
+// root; its StackMap leaves out the values the IR proves int or bool,
+// which never include params.
+// The globals are one more root frame, sized before the program starts.
+//
+// The IR (and so the IR cache) keeps no class layouts, so an object's
+// attributes get their offsets per class as its objects first set them,
+// in runtime ClassTypes of their own.  new C runs the FIELDS_NAME
+// initializers of C's bases and then C's, then C's __init__.
+//
+// A RuntimeTrap ends the run: the output so far is flushed and the trap is
+// reported as a runtimeError at the row of the statement that raised it.
+//
+// A def whose params are all int or bool is called through its JitEntry,
+// so it is compiled on its jitThreshold-th call (-j, 0 for never) if the
+// JIT takes it; a call whose ints leave 62 bits is rerun interpreted.
+// With the profiler on (-c, -p) every call is interpreted instead: each
+// enters the def's ProfileSite and each statement sets its row.
+//
+// +, comparisons and indexing run through a QuickSite per op (Quicken.h).
+
+// What the executor keeps for a def beside its IR.
+struct ExecFunction
+{
+    StackMap stackMap;
+    ProfileSite * site;
+    JitEntry * jit; // 0 if the def is always interpreted
+    vector<vector<QuickSite> > quick; // by block id, then place in the block
+
+    ExecFunction()
+        : site(0), jit(0)
+    {
+    }
+};
+
+class Executor
+{
+    enum { MAX_DEPTH = 1000 }; // calls deep, as in CPython
+
+    IRModule * module;
+    vector<Value> globals;        // a root frame; never resized once pushed
+    vector<bool> defined;         // a global has been stored
+    map<string, size_t> globalSlots;
+    map<string, ClassType *> classes;
+    map<string, vector<IRFunction *> > initializers; // FIELDS_NAME defs, bases first
+    map<IRFunction *, ExecFunction> functions;
+    int depth;
+    bool profiling;
+
+    friend struct ActiveFrame;
+
+    ExecFunction & prepare(IRFunction * f);
+    ClassType * classFor(const string & name);
+    void addInitializers(const string & cls, vector<IRFunction *> & defs, set<string> & seen);
+    size_t globalSlot(const string & name) { return globalSlots[name]; }
+    Value execute(IRFunction * f, ExecFunction & ef, vector<Value> & v);
+    Value instantiate(IRInstr * in, vector<Value> & v);
+
+public:
+    Executor(IRModule * m);
+    ~Executor();
+
+    Value call(IRFunction * f, const vector<Value> & args);
+    void run(); // MAIN_NAME, if the program has top-level statements
+};
+
+bool runProgram(IRModule * m); // false if the program trapped
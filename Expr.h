@@ -7,10 +7,45 @@ typedef ExprPair * ExprList;
 struct ExprBlock
 {
     Type type;
+    int row;    // the first source line the expression was built from
 
     ExprBlock(Type ty)
-        : type(ty)
+        : type(ty), row(::row)
     {
+        nodeArena().own(this, destroy);
+    }
+
+    virtual ~ExprBlock()
+    {
+    }
+
+    static void destroy(void * node)
+    {
+        static_cast<ExprBlock *>(node)->~ExprBlock();
+    }
+
+    // Children are built first, so a node spanning lines starts at the
+    // earliest of them.  Pooled constants are shared and have no row.
+    void startAt(Expr e)
+    {
+        if (e && !e->isConst() && e->row < row)
+            row = e->row;
+    }
+
+    void startAt(ExprList l)
+    {
+        for (; l; l = l->next)
+            startAt(l->info);
+    }
+
+    static void * operator new(size_t n)
+    {
+        return nodeArena().allocate(n);
+    }
+
+    static void operator delete(void * p)
+    {
+        // the storage goes back with the arena's blocks (Arena.h)
     }
 
     virtual void put(ostream & out)
@@ -77,6 +112,7 @@ struct UnaryExpr
     UnaryExpr(Expr f, Type ty = 0)
         : ExprBlock(ty), first(f)
     {
+        startAt(f);
     }
 
     static Expr make(Expr f)
@@ -96,6 +132,8 @@ struct BinaryExpr
     BinaryExpr(Expr f, Expr s, Type ty = 0)
         : ExprBlock(ty), first(f), second(s)
     {
+        startAt(f);
+        startAt(s);
     }
 
     static Expr make(Expr f, Expr s)
@@ -120,6 +158,8 @@ struct IndexedExpr
     IndexedExpr(Expr lst, Expr ind, Type ty = 0)
         : ExprBlock(ty), list(lst), index(ind)
     {
+        startAt(lst);
+        startAt(ind);
     }
 
     static Expr make(Expr lst, Expr ind)
@@ -147,6 +187,7 @@ struct SelectedExpr
     SelectedExpr(Expr ob, string m, Type ty = 0)
         : ExprBlock(ty), obj(ob), mem(m)
     {
+        startAt(ob);
     }
 
     static Expr make(Expr o, string m)
@@ -171,9 +212,11 @@ struct IdentExpr
 {
     string name;
     Symbol symbol;
+    int depth; // frame of the variable relative to the globals, or -1
+    int slot;  // index within that frame, or -1
 
     IdentExpr(string nm, Type ty = 0)
-        : ExprBlock(ty), name(nm)
+        : ExprBlock(ty), name(nm), symbol(0), depth(-1), slot(-1)
     {
     }
 
@@ -187,20 +230,34 @@ struct IdentExpr
         out << name;
     }
 
+    void bind(Symbol sy) // called by check() once the name is resolved
+    {
+        symbol = sy;
+        depth = sy ? sy->depth : -1;
+        slot = sy ? sy->slot : -1;
+    }
+
     virtual void check();
 };
 
 
 
+struct InlineCache;
+
 struct CallExpr
     : ExprBlock
 {
     Expr fn;
     ExprList args;
+    ClassType * receiverClass; // static class of obj in obj.m(...), if any
+    int methodIndex;           // m's slot in receiverClass->methods, or -1
+    InlineCache * cache;       // for receivers without a usable slot
 
     CallExpr(Expr fun, ExprList ars, Type ty = 0)
-        : ExprBlock(ty), fn(fun), args(ars)
+        : ExprBlock(ty), fn(fun), args(ars), receiverClass(0), methodIndex(-1), cache(0)
     {
+        startAt(fun);
+        startAt(ars);
     }
 
     static Expr make(Expr e, ExprList l)
@@ -220,6 +277,70 @@ struct CallExpr
 
 
 // CONSTANT VALUE Exprs
+//
+// A constant node is never changed after make() and checks to the same
+// type wherever it appears, so make() hands out one node per literal:
+// True, False and None are singletons, ints in [0, SMALL_INTS) come from
+// a cache and each distinct str literal is built once.  Data tables
+// written as list literals then cost one pointer per element.  The str
+// index is keyed on each node's own value, so a literal's bytes are held
+// once; -g prints the counts.
+
+// Hashes and compares the strs the keys point at.
+struct StrKeyHash
+{
+    size_t operator () (const string * s) const { return hash<string>()(*s); }
+};
+
+struct StrKeyEqual
+{
+    bool operator () (const string * a, const string * b) const { return *a == *b; }
+};
+
+struct LiteralPool
+{
+    enum { SMALL_INTS = 256 };
+
+    typedef unordered_map<const string *, Expr, StrKeyHash, StrKeyEqual> StrIndex;
+
+    Expr trueExpr, falseExpr, noneExpr;
+    Expr smallInts[SMALL_INTS];
+    StrIndex strs; // keys point into the StrConstExpr values
+    long made;   // nodes built
+    long shared; // make() calls answered with an existing node
+
+    LiteralPool()
+        : trueExpr(0), falseExpr(0), noneExpr(0), made(0), shared(0)
+    {
+        fill(smallInts, smallInts + SMALL_INTS, Expr(0));
+    }
+
+    // Forgets every pooled node, for when the arena releases them.
+    void reset()
+    {
+        trueExpr = falseExpr = noneExpr = 0;
+        fill(smallInts, smallInts + SMALL_INTS, Expr(0));
+        strs.clear();
+    }
+
+    // The pool slot for a literal, counting whether make() must fill it.
+    Expr & slot(Expr & e)
+    {
+        ++(e ? shared : made);
+        return e;
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** Literal Pool: " << made << " nodes for " << made + shared << " literals ***" << endl;
+    }
+};
+
+inline LiteralPool & literalPool()
+{
+    static LiteralPool pool;
+    return pool;
+}
 
 
 struct ConstExpr
@@ -251,7 +372,11 @@ struct BoolConstExpr
 
     static Expr make(int v)
     {
-        return new BoolConstExpr(v);
+        LiteralPool & pool = literalPool();
+        Expr & e = pool.slot(v ? pool.trueExpr : pool.falseExpr);
+        if (!e)
+            e = new BoolConstExpr(v != 0);
+        return e;
     }
 
     virtual void put(ostream & out)
@@ -275,7 +400,16 @@ struct IntConstExpr
 
     static Expr make(int i)
     {
-        return new IntConstExpr(i);
+        LiteralPool & pool = literalPool();
+        if (i < 0 || i >= LiteralPool::SMALL_INTS)
+        {
+            ++pool.made;
+            return new IntConstExpr(i);
+        }
+        Expr & e = pool.slot(pool.smallInts[i]);
+        if (!e)
+            e = new IntConstExpr(i);
+        return e;
     }
 
     virtual void put(ostream & out)
@@ -299,7 +433,17 @@ struct StrConstExpr
 
     static Expr make(string v)
     {
-        return new StrConstExpr(v);
+        LiteralPool & pool = literalPool();
+        LiteralPool::StrIndex::iterator p = pool.strs.find(&v);
+        if (p != pool.strs.end())
+        {
+            ++pool.shared;
+            return p->second;
+        }
+        ++pool.made;
+        StrConstExpr * e = new StrConstExpr(v);
+        pool.strs[&e->value] = e;
+        return e;
     }
 
     virtual void put(ostream & out)
@@ -321,7 +465,10 @@ struct NoneConstExpr
 
     static Expr make()
     {
-        return new NoneConstExpr();
+        Expr & e = literalPool().slot(literalPool().noneExpr);
+        if (!e)
+            e = new NoneConstExpr();
+        return e;
     }
 
     virtual void put(ostream & out)
@@ -873,6 +1020,7 @@ struct PrintExpr
     PrintExpr(ExprList ars, Type ty = 0)
         : ExprBlock(ty), args(ars)
     {
+        startAt(ars);
     }
 
     static Expr make(ExprList args)
@@ -899,9 +1047,12 @@ struct ObjConstrExpr
 {
     string name;
     ExprList args;
+    bool inFrame; // never escapes its def, see Escape.h
+
     ObjConstrExpr(string nm, ExprList ar, Type ty = 0)
-        : ExprBlock(ty), name(nm), args(ar)
+        : ExprBlock(ty), name(nm), args(ar), inFrame(false)
     {
+        startAt(ar);
     }
 
     static Expr make(string nm, ExprList ar)
@@ -929,6 +1080,7 @@ struct ListExpr
     ListExpr(ExprList el, Type ty = 0)
         : ExprBlock(ty), elements(el)
     {
+        startAt(el);
     }
 
     static Expr make(ExprList el)
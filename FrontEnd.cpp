@@ -0,0 +1,138 @@
+#include "all.h"
+
+int yyparse();
+void yyrestart(FILE * in);
+
+static StmtList * parsedProgram; // set while checkSource runs the parser
+
+TeeBuffer * frontEndOutput = 0;
+
+// With -k, the IR of a run that reported nothing, and what it printed so
+// far, which for -6 is all the front end prints.
+static void cacheIR(IRModule * m)
+{
+    if (!irCacheFile || !diagnostics().list.empty())
+        return;
+    string output = frontEndOutput ? frontEndOutput->copy : string();
+    if (!writeIRCache(irCacheFile, m, irSourceHash, output))
+        cerr << "Cannot write the IR cache " << irCacheFile << endl;
+}
+
+bool runFromIRCache(const char * path, unsigned long long hash)
+{
+    string output;
+    IRModule * m = readIRCache(path, hash, output);
+    if (!m)
+        return false;
+    cout << output;
+    if (HW == 6)
+        runProgram(m);
+    return true;
+}
+
+void check(StmtList L)
+{
+    for (StmtList p = L; p; p=p->next)
+    {
+        CheckingRow at(p->info->row);
+        p->info->check();
+    }
+}
+
+// The parser hands each program here.
+void do_homework(StmtList L)
+{
+    if (parsedProgram)
+    {
+        *parsedProgram = L;
+        return;
+    }
+    if (compactReport) // the mode runs on the rebuilt tree, so -m tests the round trip
+    {
+        CompactAst * c = CompactAst::make(L);
+        nodeArena().put(cout);
+        c->put(cout);
+        L = c->statements();
+    }
+    switch (HW)
+    {
+        case 3: cout << L << endl; break;
+        case 4: check(L); break;
+        case 5:
+            check(L);
+            analyzeEscapes(L);
+            if (escapeReport)
+                escapeStats.put(cout);
+            if (irDump || irCacheFile)
+            {
+                IRModule * m = compileProgram(L);
+                if (irDump)
+                    dumpIR(cout, m);
+                cacheIR(m);
+            }
+            break;
+        case 6: // run it, if it checked clean
+            check(L);
+            if (diagnostics().list.empty())
+            {
+                IRModule * m = compileProgram(L);
+                cacheIR(m);
+                runProgram(m);
+            }
+            break;
+        default:
+            compiler_error("Unknown homework option");
+    }
+}
+
+CheckResult checkSource(const char * source, size_t size, bool echo)
+{
+    // the last call's nodes, symbols and types go, with the pooled
+    // constants among them
+    static bool marked = false;
+    static Arena::Mark lastCall;
+    if (marked)
+    {
+        literalPool().reset();
+        nodeArena().release(lastCall);
+    }
+    lastCall = nodeArena().mark();
+    marked = true;
+
+    CheckResult r;
+    DiagnosticLog & log = diagnostics();
+    bool wasEcho = log.echo;
+    int wasHW = HW;
+    log.list.clear();
+    log.echo = echo;
+    HW = echo ? 4 : 0; // 4 also prints each scope as it closes
+    ST.reset();
+    ST.exited = &r.scopes;
+    row = 1;
+
+    if (size == 0)
+    {
+        source = "\n"; // fmemopen rejects an empty buffer
+        size = 1;
+    }
+    FILE * in = fmemopen(const_cast<char *>(source), size, "r");
+    if (!in)
+        compiler_error("cannot read the source buffer");
+    else
+    {
+        parsedProgram = &r.program;
+        yyrestart(in);
+        r.parsed = yyparse() == 0;
+        parsedProgram = 0;
+        fclose(in);
+        if (r.parsed)
+            check(r.program);
+    }
+
+    r.globals = ST.topScope() ? ST.topScope()->info : 0;
+    ST.exited = 0;
+    HW = wasHW;
+    log.echo = wasEcho;
+    r.diagnostics.swap(log.list);
+    return r;
+}
@@ -0,0 +1,95 @@
+// *** EMBEDDING ***
+//
+// checkSource runs the scanner, parser and checker over a buffer in
+// memory, as -4 runs them over stdin, and returns what they built instead
+// of printing it: the AST, every scope as check() closed it, the
+// top-level declarations and the diagnostics.  Nothing is written to
+// cout unless echo is set, in which case the output is that of -4.
+//
+// The front end keeps its state in globals (ST, row, the scanner), so
+// calls must not overlap; each call resets that state first.  Each call
+// also releases the AST nodes, symbols, types and scope chains of the one
+// before, and whatever else was built from the node arena since (Arena.h),
+// so a CheckResult is valid only until the next checkSource: copy out what
+// must outlive it.  Only the builtin types and their symbols are shared
+// by every call.  The ListPairs of the parser's and checker's lists come
+// from List.h's plain new and are not reclaimed.  Building
+// with -DLIBRARY=1 leaves out main() and the command-line driver, so the
+// objects can be linked into another program.
+
+#ifndef LIBRARY
+#define LIBRARY 0
+#endif
+
+// What one checkSource call built; valid until the next call.
+struct CheckResult
+{
+    bool parsed;         // the grammar accepted the source
+    StmtList program;
+    vector<pair<string, SymbolList> > scopes; // in the order they closed
+    SymbolList globals;  // the top-level scope, builtin types included
+    vector<Diagnostic> diagnostics;
+
+    CheckResult()
+        : parsed(false), program(0), globals(0)
+    {
+    }
+
+    bool ok() const { return parsed && diagnostics.empty(); }
+};
+
+CheckResult checkSource(const char * source, size_t size, bool echo = false);
+
+// Passes everything written to a stream on to its old buffer and keeps a
+// copy, until destroyed.  -k records what the front end prints to cout
+// this way, so a cache hit can print it again.
+struct TeeBuffer
+    : streambuf
+{
+    ostream & out;
+    streambuf * through;
+    string copy;
+
+    TeeBuffer(ostream & o)
+        : out(o), through(o.rdbuf(this))
+    {
+    }
+
+    ~TeeBuffer()
+    {
+        out.rdbuf(through);
+    }
+
+protected:
+    virtual int overflow(int c)
+    {
+        if (c == EOF)
+            return 0;
+        copy += (char) c;
+        return through->sputc(c);
+    }
+
+    virtual streamsize xsputn(const char * s, streamsize n)
+    {
+        copy.append(s, n);
+        return through->sputn(s, n);
+    }
+
+    virtual int sync()
+    {
+        return through->pubsync();
+    }
+};
+
+// Set while a -5 or -6 run that may be cached runs the front end: -k
+// saves the IR of a run that reported nothing, with the copy.
+extern TeeBuffer * frontEndOutput;
+
+// A -k hit: prints what the run that wrote the cache printed and, for -6,
+// runs the cached IR.  False if path holds nothing for this source.
+bool runFromIRCache(const char * path, unsigned long long hash);
+
+inline CheckResult checkSource(const string & source, bool echo = false)
+{
+    return checkSource(source.data(), source.size(), echo);
+}
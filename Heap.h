@@ -0,0 +1,309 @@
+// *** GARBAGE COLLECTOR ***
+//
+// Runtime heap objects are allocated by bumping a pointer through the
+// nursery.  When it fills, a minor collection copies the nursery objects
+// reachable from the roots and the remembered set into the mature space and
+// empties the nursery.  The mature space holds individually allocated
+// objects and is mark-swept by a major collection once it has doubled
+// since the last one.
+//
+// Roots are the frames the execution engine registers, each with a
+// StackMap saying which slots may hold pointers.  The executor builds the
+// map from the IR (Executor::prepare): slots the IR proves int or bool are
+// always immediate Values and are never scanned.  Any allocation may move
+// nursery objects, so a pointer must sit in a registered frame to survive
+// one.
+
+struct StackMap
+{
+    vector<bool> pointerSlots; // indexed by frame slot
+};
+
+struct RootFrame
+{
+    Value * slots;
+    size_t size;
+    const StackMap * map; // 0: every slot may hold a pointer
+};
+
+struct GCStats
+{
+    long allocations;
+    long minorCollections;
+    long majorCollections;
+    size_t bytesAllocated;
+    size_t bytesPromoted;
+    size_t bytesFreed;
+    double minorPauseTotal, minorPauseMax; // seconds
+    double majorPauseTotal, majorPauseMax;
+
+    GCStats()
+        : allocations(0), minorCollections(0), majorCollections(0),
+          bytesAllocated(0), bytesPromoted(0), bytesFreed(0),
+          minorPauseTotal(0), minorPauseMax(0), majorPauseTotal(0), majorPauseMax(0)
+    {
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** GC Statistics ***" << endl;
+        out << "allocations " << allocations << " bytes " << bytesAllocated << endl;
+        out << "minor collections " << minorCollections << " pause total "
+            << minorPauseTotal * 1e3 << " ms max " << minorPauseMax * 1e3 << " ms"
+            << " promoted " << bytesPromoted << " bytes" << endl;
+        out << "major collections " << majorCollections << " pause total "
+            << majorPauseTotal * 1e3 << " ms max " << majorPauseMax * 1e3 << " ms"
+            << " freed " << bytesFreed << " bytes" << endl;
+    }
+};
+
+inline size_t objectSize(HeapKind k)
+{
+    switch (k)
+    {
+        case strObj: return sizeof(StrObject);
+        case intListObj: return sizeof(IntListObject);
+        case boolListObj: return sizeof(BoolListObject);
+        case anyListObj: return sizeof(AnyListObject);
+        default: return sizeof(InstanceObject);
+    }
+}
+
+inline size_t alignedSize(size_t n)
+{
+    return (n + 15) & ~(size_t) 15;
+}
+
+// Constructs a copy of o at p, taking over o's element storage.
+inline HeapObject * moveObject(HeapObject * o, void * p)
+{
+    switch (o->kind)
+    {
+        case strObj: return new (p) StrObject(move(*static_cast<StrObject *>(o)));
+        case intListObj: return new (p) IntListObject(move(*static_cast<IntListObject *>(o)));
+        case boolListObj: return new (p) BoolListObject(move(*static_cast<BoolListObject *>(o)));
+        case anyListObj: return new (p) AnyListObject(move(*static_cast<AnyListObject *>(o)));
+        default: return new (p) InstanceObject(move(*static_cast<InstanceObject *>(o)));
+    }
+}
+
+inline void destroyObject(HeapObject * o)
+{
+    switch (o->kind)
+    {
+        case strObj: static_cast<StrObject *>(o)->~StrObject(); break;
+        case intListObj: static_cast<IntListObject *>(o)->~IntListObject(); break;
+        case boolListObj: static_cast<BoolListObject *>(o)->~BoolListObject(); break;
+        case anyListObj: static_cast<AnyListObject *>(o)->~AnyListObject(); break;
+        default: static_cast<InstanceObject *>(o)->~InstanceObject();
+    }
+}
+
+// Applies f(Value &) to every Value field of o.
+template <typename F>
+void forEachChild(HeapObject * o, F f)
+{
+    vector<Value> * v = 0;
+    if (o->kind == anyListObj)
+        v = &static_cast<AnyListObject *>(o)->elements;
+    else if (o->kind == instanceObj)
+        v = &static_cast<InstanceObject *>(o)->fields;
+    if (v)
+        for (size_t i = 0; i < v->size(); ++i)
+            f((*v)[i]);
+}
+
+class Heap
+{
+    enum { NURSERY_SIZE = 4 << 20, MIN_MATURE_LIMIT = 16 << 20 };
+
+    char * nursery;
+    char * next;
+    char * end;
+    vector<HeapObject *> mature;
+    size_t matureBytes;
+    size_t matureLimit; // major collection when matureBytes passes this
+    vector<HeapObject *> remembered;
+    vector<RootFrame> frames;
+    vector<HeapObject *> work;
+    GCStats stats;
+
+    bool inNursery(HeapObject * o)
+    {
+        return (char *) o >= nursery && (char *) o < end;
+    }
+
+    HeapObject * promote(HeapObject * o)
+    {
+        size_t size = objectSize(o->kind);
+        HeapObject * copy = moveObject(o, malloc(size));
+        copy->mature = true;
+        o->forward = copy;
+        mature.push_back(copy);
+        matureBytes += size;
+        stats.bytesPromoted += size;
+        work.push_back(copy);
+        return copy;
+    }
+
+    void evacuate(Value & v)
+    {
+        if (!v.isObject())
+            return;
+        HeapObject * o = v.asObject();
+        if (!inNursery(o))
+            return;
+        v = Value::fromObject(o->forward ? o->forward : promote(o));
+    }
+
+    template <typename F>
+    void forEachRoot(F f)
+    {
+        for (size_t k = 0; k < frames.size(); ++k)
+        {
+            RootFrame & fr = frames[k];
+            for (size_t i = 0; i < fr.size; ++i)
+                if (!fr.map || (i < fr.map->pointerSlots.size() && fr.map->pointerSlots[i]))
+                    f(fr.slots[i]);
+        }
+    }
+
+    void mark(Value v)
+    {
+        if (!v.isObject() || v.asObject()->marked)
+            return;
+        v.asObject()->marked = true;
+        work.push_back(v.asObject());
+    }
+
+public:
+    Heap()
+        : matureBytes(0), matureLimit(MIN_MATURE_LIMIT)
+    {
+        nursery = next = static_cast<char *>(malloc(NURSERY_SIZE));
+        end = nursery + NURSERY_SIZE;
+    }
+
+    void * allocate(size_t n)
+    {
+        n = alignedSize(n);
+        if (n > (size_t) (end - next))
+        {
+            collect();
+            if (matureBytes > matureLimit)
+                collectAll();
+        }
+        void * p = next;
+        next += n;
+        ++stats.allocations;
+        stats.bytesAllocated += n;
+        return p;
+    }
+
+    void rememberStore(HeapObject * holder, Value v)
+    {
+        if (holder->mature && !holder->remembered && v.isObject() && inNursery(v.asObject()))
+        {
+            holder->remembered = true;
+            remembered.push_back(holder);
+        }
+    }
+
+    void pushFrame(Value * slots, size_t size, const StackMap * map = 0)
+    {
+        RootFrame fr = {slots, size, map};
+        frames.push_back(fr);
+    }
+
+    void popFrame()
+    {
+        frames.pop_back();
+    }
+
+    // Minor collection: promote the live nursery, then empty it.
+    void collect()
+    {
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        forEachRoot([this](Value & v) { evacuate(v); });
+        for (size_t i = 0; i < remembered.size(); ++i)
+        {
+            remembered[i]->remembered = false;
+            forEachChild(remembered[i], [this](Value & v) { evacuate(v); });
+        }
+        remembered.clear();
+        while (!work.empty())
+        {
+            HeapObject * o = work.back();
+            work.pop_back();
+            forEachChild(o, [this](Value & v) { evacuate(v); });
+        }
+        for (char * p = nursery; p < next; )
+        {
+            HeapObject * o = (HeapObject *) p;
+            p += alignedSize(objectSize(o->kind));
+            destroyObject(o); // dead, or the moved-from shell of a promoted one
+        }
+        next = nursery;
+        double pause = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        ++stats.minorCollections;
+        stats.minorPauseTotal += pause;
+        stats.minorPauseMax = max(stats.minorPauseMax, pause);
+    }
+
+    // Major collection: empty the nursery, then mark-sweep the mature space.
+    void collectAll()
+    {
+        collect();
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        forEachRoot([this](Value & v) { mark(v); });
+        while (!work.empty())
+        {
+            HeapObject * o = work.back();
+            work.pop_back();
+            forEachChild(o, [this](Value & v) { mark(v); });
+        }
+        size_t live = 0;
+        for (size_t i = 0; i < mature.size(); ++i)
+        {
+            HeapObject * o = mature[i];
+            if (o->marked)
+            {
+                o->marked = false;
+                mature[live++] = o;
+            }
+            else
+            {
+                size_t size = objectSize(o->kind);
+                matureBytes -= size;
+                stats.bytesFreed += size;
+                destroyObject(o);
+                free(o);
+            }
+        }
+        mature.resize(live);
+        matureLimit = max((size_t) MIN_MATURE_LIMIT, 2 * matureBytes);
+        double pause = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        ++stats.majorCollections;
+        stats.majorPauseTotal += pause;
+        stats.majorPauseMax = max(stats.majorPauseMax, pause);
+    }
+
+    GCStats & getStats() { return stats; }
+};
+
+inline Heap & heap()
+{
+    static Heap h;
+    return h;
+}
+
+template <typename T, typename... Args>
+T * gcNew(Args... args)
+{
+    return new (heap().allocate(sizeof(T))) T(args...);
+}
+
+inline void writeBarrier(HeapObject * holder, Value v)
+{
+    heap().rememberStore(holder, v);
+}
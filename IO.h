@@ -0,0 +1,227 @@
+// *** RUNTIME I/O ***
+//
+// print formats its Values straight into a 64 KB output buffer that goes
+// out with one write(2) when it fills, before input() reads (so prompts
+// appear) and at exit.  input() reads stdin in 64 KB blocks and returns
+// each line as a StrView into the block, valid until the next input();
+// only a line that is kept, by binding it to a variable or a list, is
+// copied into a str Value, and one of up to 7 bytes never allocates.
+//
+// Anything else that writes to stdout (cout, the diagnostics) must flush
+// runtimeOut() first, as runProgram does before it reports a trap.
+
+struct StrView
+{
+    const char * chars;
+    size_t size;
+
+    string str() const { return string(chars, size); }
+};
+
+class OutBuffer
+{
+    enum { SIZE = 64 << 10 };
+
+    int fd;
+    char buf[SIZE];
+    size_t used;
+
+public:
+    OutBuffer(int f)
+        : fd(f), used(0)
+    {
+    }
+
+    ~OutBuffer()
+    {
+        flush();
+    }
+
+    // What cout and stdio hold for the same fd goes out first, so the
+    // front end's output and the program's keep their order.
+    void flush()
+    {
+        if (fd == 1)
+        {
+            cout.flush();
+            fflush(stdout);
+        }
+        for (size_t done = 0; done < used; )
+        {
+            ssize_t n = ::write(fd, buf + done, used - done);
+            if (n <= 0)
+                break;
+            done += n;
+        }
+        used = 0;
+    }
+
+    void put(const char * s, size_t n)
+    {
+        if (n > SIZE - used)
+        {
+            flush();
+            if (n > SIZE)
+            {
+                ssize_t w = ::write(fd, s, n);
+                (void) w;
+                return;
+            }
+        }
+        memcpy(buf + used, s, n);
+        used += n;
+    }
+
+    void put(char c)
+    {
+        if (used == SIZE)
+            flush();
+        buf[used++] = c;
+    }
+
+    void putInt(Int v)
+    {
+        char digits[24];
+        char * p = digits + sizeof digits;
+        unsigned long long u = v < 0 ? 0ULL - (unsigned long long) v : v;
+        do
+            *--p = '0' + u % 10;
+        while (u /= 10);
+        if (v < 0)
+            *--p = '-';
+        put(p, digits + sizeof digits - p);
+    }
+
+    void putValue(Value v)
+    {
+        if (v.isInt())
+            putInt(v.asInt());
+        else if (v.isShortStr())
+        {
+            char s[7];
+            size_t n = strLength(v);
+            for (size_t i = 0; i < n; ++i)
+                s[i] = strCharAt(v, i);
+            put(s, n);
+        }
+        else if (v.isBool())
+            v.asBool() ? put("True", 4) : put("False", 5);
+        else if (v.isNone())
+            put("None", 4);
+        else if (v.asObject()->kind == strObj)
+        {
+            StrObject * s = static_cast<StrObject *>(v.asObject());
+            put(s->data(), s->size);
+        }
+        else
+        {
+            ostringstream s; // lists and instances are rare in output
+            ::putValue(s, v);
+            put(s.str().data(), s.str().size());
+        }
+    }
+};
+
+class InBuffer
+{
+    enum { SIZE = 64 << 10 };
+
+    int fd;
+    vector<char> buf; // grows past SIZE only for a longer line
+    size_t start, end;
+    bool eof;
+
+    bool fill()
+    {
+        if (eof)
+            return false;
+        if (start > 0)
+        {
+            memmove(buf.data(), buf.data() + start, end - start);
+            end -= start;
+            start = 0;
+        }
+        if (end == buf.size())
+            buf.resize(2 * buf.size());
+        ssize_t n = ::read(fd, buf.data() + end, buf.size() - end);
+        if (n <= 0)
+            eof = true;
+        else
+            end += n;
+        return n > 0;
+    }
+
+public:
+    InBuffer(int f)
+        : fd(f), buf(SIZE), start(0), end(0), eof(false)
+    {
+    }
+
+    // The next line without its newline; false at end of input.
+    bool readLine(StrView & line)
+    {
+        size_t scanned = start;
+        for (;;)
+        {
+            const char * nl = (const char *) memchr(buf.data() + scanned, '\n', end - scanned);
+            if (nl)
+            {
+                line.chars = buf.data() + start;
+                line.size = nl - line.chars;
+                start = nl - buf.data() + 1;
+                return true;
+            }
+            scanned = end - start;
+            if (!fill())
+            {
+                if (start == end)
+                    return false;
+                line.chars = buf.data() + start; // last line, no newline
+                line.size = end - start;
+                start = end;
+                return true;
+            }
+        }
+    }
+};
+
+inline OutBuffer & runtimeOut()
+{
+    static OutBuffer out(1);
+    return out;
+}
+
+inline InBuffer & runtimeIn()
+{
+    static InBuffer in(0);
+    return in;
+}
+
+// PrintExpr: the args separated by spaces, then a newline.
+inline void runtimePrint(const Value * args, size_t n)
+{
+    OutBuffer & out = runtimeOut();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i)
+            out.put(' ');
+        out.putValue(args[i]);
+    }
+    out.put('\n');
+}
+
+// InputExpr: the line is only good until the next input().  At end of
+// input the result is empty.
+inline StrView runtimeInput()
+{
+    runtimeOut().flush();
+    StrView line = {"", 0};
+    runtimeIn().readLine(line);
+    return line;
+}
+
+// An input() result that outlives the statement.
+inline Value keepInput(StrView line)
+{
+    return makeStr(line.chars, line.size);
+}
@@ -0,0 +1,1205 @@
+#include "all.h"
+
+bool irDump = false;
+
+const char * opName(IROp op)
+{
+    static const char * names[] = {
+        "const", "str", "none", "param", "phi",
+        "add", "sub", "mul", "div", "mod", "neg", "not",
+        "eq", "ne", "lt", "le", "gt", "ge", "is", "isnot", "in", "notin",
+        "len", "getindex", "setindex", "getfield", "setfield", "gload", "gstore",
+        "list", "new", "alloc", "call", "callmethod", "print", "input",
+        "br", "cbr", "ret",
+        "addi", "cmpbr", "printstr"
+    };
+    return names[op];
+}
+
+static bool definesValue(IROp op)
+{
+    switch (op)
+    {
+        case irSetIndex: case irSetField: case irGStore: case irBr: case irCbr: case irRet:
+        case irCmpBr:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool IRInstr :: isPure()
+{
+    switch (op)
+    {
+        case irConst: case irStr: case irNone:
+        case irAdd: case irSub: case irMul: case irDiv: case irMod: case irNeg: case irNot:
+        case irEQ: case irNE: case irLT: case irLE: case irGT: case irGE:
+        case irIs: case irIsNot: case irAddImm:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Values an op makes, when it does not trap, are always ints or bools.
+static bool makesNumber(IRInstr * in)
+{
+    switch (in->op)
+    {
+        case irConst: case irSub: case irMul: case irDiv: case irMod: case irNeg: case irNot:
+        case irEQ: case irNE: case irLT: case irLE: case irGT: case irGE:
+        case irIs: case irIsNot: case irIn: case irNotIn: case irLen: case irAddImm:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Arithmetic traps past 62 bits or on a zero divisor, and any op that
+// looks at its operands' types traps on a value of the wrong type, which
+// an any can bring to it.  Only == and != take anything.
+bool IRInstr :: mayTrap()
+{
+    switch (op)
+    {
+        case irAdd: case irSub: case irMul: case irDiv: case irMod: case irNeg: case irAddImm:
+        case irIn: case irNotIn: case irLen: case irGetField: case irSetField: case irGLoad:
+            return true;
+        case irLT: case irLE: case irGT: case irGE:
+            return !makesNumber(args[0]) || !makesNumber(args[1]);
+        case irGetIndex: case irSetIndex:
+            return !inRange;
+        default:
+            return false;
+    }
+}
+
+bool IRInstr :: hasEffects()
+{
+    switch (op)
+    {
+        case irSetIndex: case irSetField: case irGStore: case irNew:
+        case irCall: case irCallMethod: case irPrint: case irInput:
+        case irBr: case irCbr: case irRet: case irCmpBr: case irPrintStr:
+            return true;
+        default:
+            return mayTrap();
+    }
+}
+
+void IRInstr :: put(ostream & out)
+{
+    out << "  ";
+    if (id >= 0)
+        out << '%' << id << " = ";
+    out << opName(op);
+    if (op == irConst && type && type->behavior(isBool))
+        out << (imm ? " True" : " False");
+    else if (op == irConst)
+        out << ' ' << imm;
+    if (!name.empty())
+    {
+        bool quoted = op == irStr || op == irPrintStr;
+        out << (quoted ? " \"" : " ") << name << (quoted ? "\"" : "");
+    }
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        out << (i || op == irConst || !name.empty() ? ", " : " ");
+        if (op == irPhi)
+            out << "[%" << args[i]->id << ", b" << targets[i]->id << "]";
+        else
+            out << '%' << args[i]->id;
+    }
+    if (op == irAddImm)
+        out << ", " << imm;
+    if (op != irPhi)
+        for (size_t i = 0; i < targets.size(); ++i)
+            out << (i || !args.empty() ? ", b" : " b") << targets[i]->id;
+    if (inRange)
+        out << "  ; in range";
+    out << endl;
+}
+
+void IRFunction :: put(ostream & out)
+{
+    out << "def " << name << "(";
+    for (size_t i = 0; i < params.size(); ++i)
+        out << (i ? ", %" : "%") << params[i]->id;
+    out << "):" << endl;
+    for (size_t k = 0; k < blocks.size(); ++k)
+    {
+        IRBlock * b = blocks[k];
+        out << "b" << b->id << ":";
+        if (!b->preds.empty())
+        {
+            out << "  ; preds";
+            for (size_t i = 0; i < b->preds.size(); ++i)
+                out << " b" << b->preds[i]->id;
+        }
+        out << endl;
+        for (size_t i = 0; i < b->instrs.size(); ++i)
+            b->instrs[i]->put(out);
+    }
+}
+
+
+// *** LOWERING ***
+//
+// SSA is built while lowering, following Braun et al., "Simple and
+// Efficient Construction of Static Single Assignment Form": a read of a
+// local looks for its definition in the current block and then through
+// the preds, placing a phi where they meet; blocks whose preds are not all
+// known yet get placeholder phis that are completed when sealed.
+
+static IRInstr * resolve(IRInstr * v)
+{
+    while (v && v->replacement)
+        v = v->replacement;
+    return v;
+}
+
+struct IRBuilder
+{
+    IRFunction * f;
+    IRBlock * cur;
+    set<string> locals;
+    map<IRBlock *, map<string, IRInstr *> > defs;
+    map<IRBlock *, map<string, IRInstr *> > incompletePhis;
+    vector<IRBlock *> breakTargets, continueTargets;
+    int hiddenVars;
+    int row; // of the statement being lowered
+
+    IRBuilder(IRFunction * fn)
+        : f(fn), cur(0), hiddenVars(0), row(-1)
+    {
+    }
+
+    IRInstr * emit(IROp op, IRInstr * a = 0, IRInstr * b = 0)
+    {
+        IRInstr * in = new IRInstr(op, 0);
+        in->block = cur;
+        in->row = row;
+        if (a) in->args.push_back(a);
+        if (b) in->args.push_back(b);
+        in->id = definesValue(op) ? f->nextValue++ : -1;
+        cur->instrs.push_back(in);
+        return in;
+    }
+
+    IRInstr * constant(long long v)
+    {
+        IRInstr * in = emit(irConst);
+        in->imm = v;
+        return in;
+    }
+
+    IRInstr * boolean(bool b) // kept apart from the int constants 0 and 1
+    {
+        IRInstr * in = constant(b);
+        in->type = BoolType::make();
+        return in;
+    }
+
+    void edge(IRBlock * from, IRBlock * to)
+    {
+        from->succs.push_back(to);
+        to->preds.push_back(from);
+    }
+
+    void br(IRBlock * to)
+    {
+        if (cur->terminator())
+            return;
+        emit(irBr)->targets.push_back(to);
+        edge(cur, to);
+    }
+
+    void cbr(IRInstr * cond, IRBlock * t, IRBlock * e)
+    {
+        IRInstr * in = emit(irCbr, cond);
+        in->targets.push_back(t);
+        in->targets.push_back(e);
+        edge(cur, t);
+        edge(cur, e);
+    }
+
+    // After a return, break or continue, code lowers into an unreachable block.
+    void startDeadBlock()
+    {
+        cur = f->newBlock();
+        cur->sealed = true;
+    }
+
+    // *** SSA construction ***
+
+    void writeVariable(const string & var, IRBlock * b, IRInstr * v)
+    {
+        defs[b][var] = v;
+    }
+
+    IRInstr * newPhi(IRBlock * b)
+    {
+        IRInstr * phi = new IRInstr(irPhi, f->nextValue++);
+        phi->block = b;
+        phi->row = row;
+        size_t n = 0;
+        while (n < b->instrs.size() && b->instrs[n]->op == irPhi)
+            ++n;
+        b->instrs.insert(b->instrs.begin() + n, phi);
+        return phi;
+    }
+
+    IRInstr * undefined(IRBlock * b) // a read with no reaching definition
+    {
+        IRInstr * in = new IRInstr(irNone, f->nextValue++);
+        in->block = b;
+        in->row = row;
+        size_t n = 0;
+        while (n < b->instrs.size() && b->instrs[n]->op == irPhi)
+            ++n;
+        b->instrs.insert(b->instrs.begin() + n, in);
+        return in;
+    }
+
+    IRInstr * readVariable(const string & var, IRBlock * b)
+    {
+        map<string, IRInstr *> & d = defs[b];
+        map<string, IRInstr *>::iterator it = d.find(var);
+        if (it != d.end())
+            return resolve(it->second);
+        IRInstr * v;
+        if (!b->sealed)
+        {
+            v = newPhi(b);
+            incompletePhis[b][var] = v;
+        }
+        else if (b->preds.size() == 1)
+            v = readVariable(var, b->preds[0]);
+        else if (b->preds.empty())
+            v = undefined(b);
+        else
+        {
+            IRInstr * phi = newPhi(b);
+            writeVariable(var, b, phi);
+            v = addPhiOperands(var, phi);
+        }
+        writeVariable(var, b, v);
+        return v;
+    }
+
+    IRInstr * addPhiOperands(const string & var, IRInstr * phi)
+    {
+        IRBlock * b = phi->block;
+        for (size_t i = 0; i < b->preds.size(); ++i)
+        {
+            phi->args.push_back(readVariable(var, b->preds[i]));
+            phi->targets.push_back(b->preds[i]);
+        }
+        return tryRemoveTrivialPhi(phi);
+    }
+
+    IRInstr * tryRemoveTrivialPhi(IRInstr * phi)
+    {
+        IRInstr * same = 0;
+        for (size_t i = 0; i < phi->args.size(); ++i)
+        {
+            IRInstr * op = resolve(phi->args[i]);
+            if (op == same || op == phi)
+                continue;
+            if (same)
+                return phi;
+            same = op;
+        }
+        if (!same)
+            same = undefined(phi->block);
+        phi->replacement = same;
+        vector<IRInstr *> & in = phi->block->instrs;
+        in.erase(find(in.begin(), in.end(), phi));
+        return same;
+    }
+
+    void sealBlock(IRBlock * b)
+    {
+        map<string, IRInstr *> & pending = incompletePhis[b];
+        b->sealed = true;
+        for (map<string, IRInstr *>::iterator it = pending.begin(); it != pending.end(); ++it)
+            addPhiOperands(it->first, it->second);
+        pending.clear();
+    }
+
+    // *** locals ***
+
+    void collectLocals(Stmt s)
+    {
+        if (VarStmt * vs = dynamic_cast<VarStmt *>(s))
+            locals.insert(vs->name);
+        else if (ForStmt * fs = dynamic_cast<ForStmt *>(s))
+        {
+            locals.insert(fs->ident);
+            collectLocals(fs->stmt);
+        }
+        else if (IfStmt * is = dynamic_cast<IfStmt *>(s))
+        {
+            collectLocals(is->trueStmt);
+            collectLocals(is->falseStmt);
+        }
+        else if (WhileStmt * ws = dynamic_cast<WhileStmt *>(s))
+            collectLocals(ws->stmt);
+        else if (BlockStmt * bs = dynamic_cast<BlockStmt *>(s))
+            for (StmtList p = bs->stmts; p; p = p->next)
+                collectLocals(p->info);
+    }
+
+    // *** expressions ***
+
+    IRInstr * exprs(IROp op, ExprList L)
+    {
+        vector<IRInstr *> args;
+        for (; L; L = L->next)
+            args.push_back(expr(L->info));
+        IRInstr * in = emit(op);
+        in->args = args;
+        return in;
+    }
+
+    IRInstr * binary(IROp op, BinaryExpr * be)
+    {
+        IRInstr * a = expr(be->first);
+        IRInstr * b = expr(be->second);
+        return emit(op, a, b);
+    }
+
+    IRInstr * shortCircuit(BinaryExpr * be, bool isAnd)
+    {
+        IRInstr * a = expr(be->first);
+        IRBlock * from = cur;
+        IRBlock * rhs = f->newBlock();
+        IRBlock * join = f->newBlock();
+        if (isAnd)
+            cbr(a, rhs, join);
+        else
+            cbr(a, join, rhs);
+        sealBlock(rhs);
+        cur = rhs;
+        IRInstr * b = expr(be->second);
+        IRBlock * rhsEnd = cur;
+        br(join);
+        sealBlock(join);
+        cur = join;
+        IRInstr * phi = newPhi(join);
+        phi->args.push_back(a);
+        phi->targets.push_back(from);
+        phi->args.push_back(b);
+        phi->targets.push_back(rhsEnd);
+        return phi;
+    }
+
+    // x in [c, ...] with int or str constants never builds the list: ints
+    // are found by a balanced tree of compares, as a switch is lowered, and
+    // strs by a chain of ==.  Returns 0 for any other list.
+    IRInstr * constantMembership(BinaryExpr * be, bool negate)
+    {
+        ListExpr * le = dynamic_cast<ListExpr *>(be->second);
+        if (!le)
+            return 0;
+        vector<long long> ints;
+        vector<string> strs;
+        for (ExprList p = le->elements; p; p = p->next)
+            if (IntConstExpr * ic = dynamic_cast<IntConstExpr *>(p->info))
+                ints.push_back(ic->value);
+            else if (StrConstExpr * sc = dynamic_cast<StrConstExpr *>(p->info))
+                strs.push_back(sc->value);
+            else
+                return 0;
+        if (!ints.empty() && !strs.empty())
+            return 0;
+        sort(ints.begin(), ints.end());
+        ints.erase(unique(ints.begin(), ints.end()), ints.end());
+        sort(strs.begin(), strs.end());
+        strs.erase(unique(strs.begin(), strs.end()), strs.end());
+
+        IRInstr * x = expr(be->first);
+        IRBlock * yes = f->newBlock();
+        IRBlock * no = f->newBlock();
+        IRBlock * join = f->newBlock();
+        if (!strs.empty())
+            for (size_t i = 0; i < strs.size(); ++i)
+            {
+                IRInstr * s = emit(irStr);
+                s->name = strs[i];
+                nextCase(emit(irEQ, x, s), yes);
+            }
+        else
+            searchCases(x, ints, 0, ints.size(), yes);
+        br(no);
+        sealBlock(yes);
+        sealBlock(no);
+        cur = yes;
+        IRInstr * t = boolean(!negate);
+        br(join);
+        cur = no;
+        IRInstr * e = boolean(negate);
+        br(join);
+        sealBlock(join);
+        cur = join;
+        IRInstr * phi = newPhi(join);
+        phi->args.push_back(t);
+        phi->targets.push_back(yes);
+        phi->args.push_back(e);
+        phi->targets.push_back(no);
+        return phi;
+    }
+
+    // Branches to found if test holds, else continues in a new block.
+    void nextCase(IRInstr * test, IRBlock * found)
+    {
+        IRBlock * next = f->newBlock();
+        cbr(test, found, next);
+        sealBlock(next);
+        cur = next;
+    }
+
+    // Branches to found if x is one of v[lo .. hi), else falls out of cur.
+    void searchCases(IRInstr * x, vector<long long> & v, size_t lo, size_t hi, IRBlock * found)
+    {
+        if (hi - lo <= 3)
+        {
+            for (size_t i = lo; i < hi; ++i)
+                nextCase(emit(irEQ, x, constant(v[i])), found);
+            return;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        IRBlock * left = f->newBlock();
+        IRBlock * right = f->newBlock();
+        IRBlock * miss = f->newBlock();
+        cbr(emit(irLT, x, constant(v[mid])), left, right);
+        sealBlock(left);
+        sealBlock(right);
+        cur = left;
+        searchCases(x, v, lo, mid, found);
+        br(miss);
+        cur = right;
+        searchCases(x, v, mid, hi, found);
+        br(miss);
+        sealBlock(miss);
+        cur = miss;
+    }
+
+    IRInstr * expr(Expr e)
+    {
+        if (IntConstExpr * ic = dynamic_cast<IntConstExpr *>(e))
+            return constant(ic->value);
+        if (BoolConstExpr * bc = dynamic_cast<BoolConstExpr *>(e))
+            return boolean(bc->value != 0);
+        if (StrConstExpr * sc = dynamic_cast<StrConstExpr *>(e))
+        {
+            IRInstr * in = emit(irStr);
+            in->name = sc->value;
+            return in;
+        }
+        if (dynamic_cast<NoneConstExpr *>(e))
+            return emit(irNone);
+        if (IdentExpr * id = dynamic_cast<IdentExpr *>(e))
+        {
+            if (locals.count(id->name))
+                return readVariable(id->name, cur);
+            IRInstr * in = emit(irGLoad);
+            in->name = id->name;
+            return in;
+        }
+        if (AssignExpr * ae = dynamic_cast<AssignExpr *>(e))
+            return assign(ae->first, expr(ae->second));
+        if (dynamic_cast<PlusExpr *>(e)) return binary(irAdd, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<MinusExpr *>(e)) return binary(irSub, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<TimesExpr *>(e)) return binary(irMul, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<DivideExpr *>(e)) return binary(irDiv, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<ModuloExpr *>(e)) return binary(irMod, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<AndExpr *>(e)) return shortCircuit(static_cast<BinaryExpr *>(e), true);
+        if (dynamic_cast<OrExpr *>(e)) return shortCircuit(static_cast<BinaryExpr *>(e), false);
+        if (dynamic_cast<EQExpr *>(e)) return binary(irEQ, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<NEExpr *>(e)) return binary(irNE, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<LTExpr *>(e)) return binary(irLT, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<LEExpr *>(e)) return binary(irLE, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<GTExpr *>(e)) return binary(irGT, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<GEExpr *>(e)) return binary(irGE, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<NotInExpr *>(e) || dynamic_cast<InExpr *>(e))
+        {
+            BinaryExpr * be = static_cast<BinaryExpr *>(e);
+            bool negate = dynamic_cast<NotInExpr *>(e) != 0;
+            if (IRInstr * in = constantMembership(be, negate))
+                return in;
+            return binary(negate ? irNotIn : irIn, be);
+        }
+        if (dynamic_cast<IsNotExpr *>(e)) return binary(irIsNot, static_cast<BinaryExpr *>(e));
+        if (dynamic_cast<IsExpr *>(e)) return binary(irIs, static_cast<BinaryExpr *>(e));
+        if (NotExpr * ne = dynamic_cast<NotExpr *>(e))
+            return emit(irNot, expr(ne->first));
+        if (UnaryMinusExpr * ue = dynamic_cast<UnaryMinusExpr *>(e))
+            return emit(irNeg, expr(ue->first));
+        if (UnaryPlusExpr * ue = dynamic_cast<UnaryPlusExpr *>(e))
+            return expr(ue->first);
+        if (IndexedExpr * ie = dynamic_cast<IndexedExpr *>(e))
+        {
+            IRInstr * l = expr(ie->list);
+            return emit(irGetIndex, l, expr(ie->index));
+        }
+        if (SelectedExpr * se = dynamic_cast<SelectedExpr *>(e))
+        {
+            IRInstr * in = emit(irGetField, expr(se->obj));
+            in->name = se->mem;
+            return in;
+        }
+        if (CallExpr * ce = dynamic_cast<CallExpr *>(e))
+        {
+            if (SelectedExpr * m = dynamic_cast<SelectedExpr *>(ce->fn))
+            {
+                IRInstr * obj = expr(m->obj);
+                IRInstr * in = exprs(irCallMethod, ce->args);
+                in->args.insert(in->args.begin(), obj);
+                in->name = m->mem;
+                return in;
+            }
+            IdentExpr * fn = dynamic_cast<IdentExpr *>(ce->fn);
+            if (fn && !locals.count(fn->name)) // a local holding a function is called indirectly
+            {
+                if (fn->name == "len" && ce->args && !ce->args->next)
+                    return emit(irLen, expr(ce->args->info));
+                IRInstr * in = exprs(irCall, ce->args);
+                in->name = fn->name;
+                return in;
+            }
+            IRInstr * callee = expr(ce->fn);
+            IRInstr * in = exprs(irCall, ce->args);
+            in->args.insert(in->args.begin(), callee);
+            return in;
+        }
+        if (ObjConstrExpr * oe = dynamic_cast<ObjConstrExpr *>(e))
+        {
+            IRInstr * in = exprs(irNew, oe->args);
+            in->name = oe->name;
+            return in;
+        }
+        if (ListExpr * le = dynamic_cast<ListExpr *>(e))
+        {
+            IRInstr * in = exprs(irList, le->elements);
+            if (ListType * lt = dynamic_cast<ListType *>(le->type))
+                in->type = lt->elementType;
+            return in;
+        }
+        if (PrintExpr * pe = dynamic_cast<PrintExpr *>(e))
+            return exprs(irPrint, pe->args);
+        if (dynamic_cast<InputExpr *>(e))
+            return emit(irInput);
+        compiler_error("IR lowering: unexpected expression");
+        return emit(irNone);
+    }
+
+    IRInstr * assign(Expr target, IRInstr * v)
+    {
+        if (IdentExpr * id = dynamic_cast<IdentExpr *>(target))
+            setVariable(id->name, v);
+        else if (SelectedExpr * se = dynamic_cast<SelectedExpr *>(target))
+            emit(irSetField, expr(se->obj), v)->name = se->mem;
+        else if (IndexedExpr * ie = dynamic_cast<IndexedExpr *>(target))
+        {
+            IRInstr * l = expr(ie->list);
+            IRInstr * in = emit(irSetIndex, l, expr(ie->index));
+            in->args.push_back(v);
+        }
+        return v;
+    }
+
+    // *** statements ***
+
+    void stmts(StmtList L)
+    {
+        for (; L; L = L->next)
+            stmt(L->info);
+    }
+
+    void loopBody(Stmt body, IRBlock * brk, IRBlock * cont)
+    {
+        breakTargets.push_back(brk);
+        continueTargets.push_back(cont);
+        stmt(body);
+        breakTargets.pop_back();
+        continueTargets.pop_back();
+    }
+
+    // A local is an SSA value; any other name (at top level, every name) is
+    // a global.
+    void setVariable(const string & var, IRInstr * v)
+    {
+        if (locals.count(var))
+            writeVariable(var, cur, v);
+        else
+            emit(irGStore, v)->name = var;
+    }
+
+    void stmt(Stmt s)
+    {
+        if (!s)
+            return;
+        int outer = row;
+        row = s->row;
+        lowerStmt(s);
+        row = outer;
+    }
+
+    void lowerStmt(Stmt s)
+    {
+        if (VarStmt * vs = dynamic_cast<VarStmt *>(s))
+            setVariable(vs->name, vs->init ? expr(vs->init) : emit(irNone));
+        else if (AssignStmt * as = dynamic_cast<AssignStmt *>(s))
+            expr(as->object);
+        else if (CallStmt * cs = dynamic_cast<CallStmt *>(s))
+            expr(cs->object);
+        else if (BlockStmt * bs = dynamic_cast<BlockStmt *>(s))
+            stmts(bs->stmts);
+        else if (ReturnStmt * rs = dynamic_cast<ReturnStmt *>(s))
+        {
+            emit(irRet, rs->expr ? expr(rs->expr) : 0);
+            startDeadBlock();
+        }
+        else if (IfStmt * is = dynamic_cast<IfStmt *>(s))
+        {
+            IRInstr * c = expr(is->cond);
+            IRBlock * t = f->newBlock();
+            IRBlock * e = f->newBlock();
+            IRBlock * join = is->falseStmt ? f->newBlock() : e;
+            cbr(c, t, e);
+            sealBlock(t);
+            cur = t;
+            stmt(is->trueStmt);
+            br(join);
+            if (is->falseStmt)
+            {
+                sealBlock(e);
+                cur = e;
+                stmt(is->falseStmt);
+                br(join);
+            }
+            sealBlock(join);
+            cur = join;
+        }
+        else if (WhileStmt * ws = dynamic_cast<WhileStmt *>(s))
+        {
+            IRBlock * header = f->newBlock();
+            IRBlock * body = f->newBlock();
+            IRBlock * exit = f->newBlock();
+            br(header);
+            cur = header;
+            cbr(expr(ws->cond), body, exit);
+            sealBlock(body);
+            cur = body;
+            loopBody(ws->stmt, exit, header);
+            br(header);
+            sealBlock(header);
+            sealBlock(exit);
+            cur = exit;
+        }
+        else if (ForStmt * fs = dynamic_cast<ForStmt *>(s))
+        {
+            // for x in l: body  ==>  i = 0; while i < len(l): x = l[i]; body; i = i + 1
+            string index = "for." + to_string(hiddenVars++);
+            IRInstr * list = expr(fs->ex);
+            writeVariable(index, cur, constant(0));
+            IRBlock * header = f->newBlock();
+            IRBlock * body = f->newBlock();
+            IRBlock * latch = f->newBlock();
+            IRBlock * exit = f->newBlock();
+            br(header);
+            cur = header;
+            IRInstr * i = readVariable(index, header);
+            cbr(emit(irLT, i, emit(irLen, list)), body, exit);
+            sealBlock(body);
+            cur = body;
+            setVariable(fs->ident, emit(irGetIndex, list, readVariable(index, cur)));
+            loopBody(fs->stmt, exit, latch);
+            br(latch);
+            sealBlock(latch);
+            cur = latch;
+            writeVariable(index, cur, emit(irAdd, readVariable(index, cur), constant(1)));
+            br(header);
+            sealBlock(header);
+            sealBlock(exit);
+            cur = exit;
+        }
+        else if (dynamic_cast<BreakStmt *>(s))
+        {
+            br(breakTargets.back());
+            startDeadBlock();
+        }
+        else if (dynamic_cast<ContinueStmt *>(s))
+        {
+            br(continueTargets.back());
+            startDeadBlock();
+        }
+        // PassStmt lowers to nothing; nested defs and classes get their own IR
+    }
+};
+
+// Rewrites every operand through folded phis and replaced values.
+void resolveOperands(IRFunction * f)
+{
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        vector<IRInstr *> & in = f->blocks[k]->instrs;
+        for (size_t i = 0; i < in.size(); ++i)
+            for (size_t j = 0; j < in[i]->args.size(); ++j)
+                in[i]->args[j] = resolve(in[i]->args[j]);
+    }
+}
+
+// The top-level statements other than defs and classes, with every name
+// a global; 0 if there are none.
+static IRFunction * lowerMain(StmtList L)
+{
+    IRFunction * f = new IRFunction(MAIN_NAME);
+    IRBuilder b(f);
+    b.cur = f->newBlock();
+    b.cur->sealed = true;
+    bool any = false;
+    for (; L; L = L->next)
+        if (!dynamic_cast<DefStmt *>(L->info) && !dynamic_cast<ClassStmt *>(L->info))
+        {
+            b.stmt(L->info);
+            any = true;
+        }
+    if (!any)
+        return 0;
+    if (!b.cur->terminator())
+        b.emit(irRet);
+    resolveOperands(f);
+    return f;
+}
+
+// C.FIELDS_NAME(self) sets each attribute declared in C's body; 0 if it
+// declares none.
+static IRFunction * lowerFields(ClassStmt * cls)
+{
+    BlockStmt * body = dynamic_cast<BlockStmt *>(cls->body);
+    vector<VarStmt *> attributes;
+    for (StmtList p = body ? body->stmts : 0; p; p = p->next)
+        if (VarStmt * vs = dynamic_cast<VarStmt *>(p->info))
+            attributes.push_back(vs);
+    if (VarStmt * vs = dynamic_cast<VarStmt *>(cls->body))
+        attributes.push_back(vs);
+    if (attributes.empty())
+        return 0;
+    IRFunction * f = new IRFunction(cls->name + "." + FIELDS_NAME);
+    IRBuilder b(f);
+    b.cur = f->newBlock();
+    b.cur->sealed = true;
+    IRInstr * self = b.emit(irParam);
+    self->name = "self";
+    f->params.push_back(self);
+    for (size_t i = 0; i < attributes.size(); ++i)
+    {
+        b.row = attributes[i]->row;
+        IRInstr * v = attributes[i]->init ? b.expr(attributes[i]->init) : b.emit(irNone);
+        b.emit(irSetField, self, v)->name = attributes[i]->name;
+    }
+    b.emit(irRet);
+    resolveOperands(f);
+    return f;
+}
+
+IRFunction * lowerToIR(DefStmt * def)
+{
+    IRFunction * f = new IRFunction(def->name);
+    IRBuilder b(f);
+    b.cur = f->newBlock();
+    b.cur->sealed = true;
+    b.row = def->row;
+    for (StmtList p = def->params; p; p = p->next)
+        if (ParamStmt * ps = dynamic_cast<ParamStmt *>(p->info))
+        {
+            IRInstr * in = b.emit(irParam);
+            in->name = ps->name;
+            in->type = ps->type;
+            f->params.push_back(in);
+            b.locals.insert(ps->name);
+            b.writeVariable(ps->name, b.cur, in);
+        }
+    b.collectLocals(def->body);
+    b.stmt(def->body);
+    if (!b.cur->terminator())
+        b.emit(irRet);
+    resolveOperands(f);
+    return f;
+}
+
+
+// *** PASSES ***
+
+static void removePred(IRBlock * b, IRBlock * pred)
+{
+    for (size_t i = 0; i < b->preds.size(); )
+        if (b->preds[i] == pred)
+        {
+            b->preds.erase(b->preds.begin() + i);
+            for (size_t k = 0; k < b->instrs.size() && b->instrs[k]->op == irPhi; ++k)
+            {
+                b->instrs[k]->args.erase(b->instrs[k]->args.begin() + i);
+                b->instrs[k]->targets.erase(b->instrs[k]->targets.begin() + i);
+            }
+        }
+        else
+            ++i;
+}
+
+// Dropping preds can leave phis whose inputs, apart from the phi itself,
+// are all one value; each is replaced by that value until none remain.
+static void removeTrivialPhis(IRFunction * f)
+{
+    for (bool changed = true; changed; )
+    {
+        changed = false;
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+        {
+            vector<IRInstr *> & in = f->blocks[k]->instrs;
+            for (size_t i = 0; i < in.size() && in[i]->op == irPhi; )
+            {
+                IRInstr * same = 0;
+                bool trivial = true;
+                for (size_t j = 0; trivial && j < in[i]->args.size(); ++j)
+                {
+                    IRInstr * op = resolve(in[i]->args[j]);
+                    if (op != in[i] && op != same)
+                        trivial = !same;
+                    if (op != in[i])
+                        same = op;
+                }
+                if (trivial && same)
+                {
+                    in[i]->replacement = same;
+                    in.erase(in.begin() + i);
+                    changed = true;
+                }
+                else
+                    ++i;
+            }
+        }
+    }
+    resolveOperands(f);
+}
+
+void foldBranches(IRFunction * f)
+{
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        IRBlock * b = f->blocks[k];
+        IRInstr * t = b->terminator();
+        if (!t || t->op != irCbr || t->args[0]->op != irConst)
+            continue;
+        IRBlock * taken = t->targets[t->args[0]->imm ? 0 : 1];
+        IRBlock * dropped = t->targets[t->args[0]->imm ? 1 : 0];
+        t->op = irBr;
+        t->args.clear();
+        t->targets.assign(1, taken);
+        b->succs.assign(1, taken);
+        if (dropped != taken)
+            removePred(dropped, b);
+    }
+}
+
+static void numberBlocks(IRBlock * b, vector<IRBlock *> & post, set<IRBlock *> & seen)
+{
+    seen.insert(b);
+    for (size_t i = 0; i < b->succs.size(); ++i)
+        if (!seen.count(b->succs[i]))
+            numberBlocks(b->succs[i], post, seen);
+    post.push_back(b);
+}
+
+void removeUnreachable(IRFunction * f)
+{
+    vector<IRBlock *> post;
+    set<IRBlock *> seen;
+    numberBlocks(f->blocks[0], post, seen);
+    vector<IRBlock *> live;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        IRBlock * b = f->blocks[k];
+        if (seen.count(b))
+            live.push_back(b);
+        else
+            for (size_t i = 0; i < b->succs.size(); ++i)
+                removePred(b->succs[i], b);
+    }
+    f->blocks = live;
+    removeTrivialPhis(f);
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+void computeDominators(IRFunction * f)
+{
+    vector<IRBlock *> post;
+    set<IRBlock *> seen;
+    numberBlocks(f->blocks[0], post, seen);
+    vector<IRBlock *> rpo(post.rbegin(), post.rend());
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        f->blocks[k]->order = -1;
+        f->blocks[k]->idom = 0;
+    }
+    for (size_t i = 0; i < rpo.size(); ++i)
+        rpo[i]->order = i;
+    rpo[0]->idom = rpo[0];
+    for (bool changed = true; changed; )
+    {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); ++i)
+        {
+            IRBlock * b = rpo[i];
+            IRBlock * idom = 0;
+            for (size_t p = 0; p < b->preds.size(); ++p)
+            {
+                IRBlock * x = b->preds[p];
+                if (!x->idom)
+                    continue;
+                if (!idom)
+                {
+                    idom = x;
+                    continue;
+                }
+                IRBlock * y = idom;
+                while (x != y)
+                {
+                    while (x->order > y->order) x = x->idom;
+                    while (y->order > x->order) y = y->idom;
+                }
+                idom = x;
+            }
+            if (idom != b->idom)
+            {
+                b->idom = idom;
+                changed = true;
+            }
+        }
+    }
+    f->blocks = rpo;
+}
+
+static bool dominates(IRBlock * a, IRBlock * b)
+{
+    while (b != a && b->idom != b)
+        b = b->idom;
+    return a == b;
+}
+
+typedef map<vector<long long>, IRInstr *> ValueTable;
+
+static vector<long long> valueKey(IRInstr * in)
+{
+    vector<long long> key;
+    key.push_back(in->op);
+    key.push_back(in->imm);
+    key.push_back(in->type && in->type->behavior(isBool)); // True is not 1
+    for (size_t i = 0; i < in->args.size(); ++i)
+        key.push_back(in->args[i]->id);
+    if (in->op == irStr) // strings are keyed by their text
+        for (size_t i = 0; i < in->name.size(); ++i)
+            key.push_back(in->name[i]);
+    return key;
+}
+
+static void numberValues(IRBlock * b, ValueTable table, map<IRBlock *, vector<IRBlock *> > & kids)
+{
+    vector<IRInstr *> & in = b->instrs;
+    for (size_t i = 0; i < in.size(); )
+    {
+        for (size_t j = 0; j < in[i]->args.size(); ++j)
+            in[i]->args[j] = resolve(in[i]->args[j]);
+        if (in[i]->isPure())
+        {
+            vector<long long> key = valueKey(in[i]);
+            ValueTable::iterator it = table.find(key);
+            if (it != table.end())
+            {
+                in[i]->replacement = it->second;
+                in.erase(in.begin() + i);
+                continue;
+            }
+            table[key] = in[i];
+        }
+        ++i;
+    }
+    vector<IRBlock *> & children = kids[b];
+    for (size_t k = 0; k < children.size(); ++k)
+        numberValues(children[k], table, kids);
+}
+
+void eliminateCommonSubexprs(IRFunction * f)
+{
+    computeDominators(f);
+    map<IRBlock *, vector<IRBlock *> > kids;
+    for (size_t k = 1; k < f->blocks.size(); ++k)
+        kids[f->blocks[k]->idom].push_back(f->blocks[k]);
+    numberValues(f->blocks[0], ValueTable(), kids);
+    resolveOperands(f);
+}
+
+// A while/for loop is the set of blocks of a back edge latch -> header,
+// where header dominates latch.  Its preheader is the header's only
+// outside pred, which the lowering always ends with a plain br.
+void hoistLoopInvariants(IRFunction * f)
+{
+    computeDominators(f);
+    for (size_t h = f->blocks.size(); h-- > 0; ) // inner loops first
+    {
+        IRBlock * header = f->blocks[h];
+        set<IRBlock *> loop;
+        vector<IRBlock *> work;
+        IRBlock * preheader = 0;
+        for (size_t p = 0; p < header->preds.size(); ++p)
+        {
+            IRBlock * latch = header->preds[p];
+            if (dominates(header, latch))
+                work.push_back(latch);
+            else if (!preheader)
+                preheader = latch;
+            else
+                preheader = header; // more than one way in: no preheader
+        }
+        if (work.empty() || !preheader || preheader == header || preheader->succs.size() != 1)
+            continue;
+        loop.insert(header);
+        while (!work.empty())
+        {
+            IRBlock * b = work.back();
+            work.pop_back();
+            if (loop.insert(b).second)
+                for (size_t p = 0; p < b->preds.size(); ++p)
+                    work.push_back(b->preds[p]);
+        }
+        vector<IRInstr *> & pre = preheader->instrs;
+        for (bool changed = true; changed; )
+        {
+            changed = false;
+            for (size_t k = 0; k < f->blocks.size(); ++k)
+            {
+                IRBlock * b = f->blocks[k];
+                if (!loop.count(b))
+                    continue;
+                vector<IRInstr *> & in = b->instrs;
+                for (size_t i = 0; i < in.size(); )
+                {
+                    bool invariant = in[i]->isPure() && !in[i]->mayTrap();
+                    for (size_t j = 0; invariant && j < in[i]->args.size(); ++j)
+                        invariant = !loop.count(in[i]->args[j]->block);
+                    if (!invariant)
+                    {
+                        ++i;
+                        continue;
+                    }
+                    in[i]->block = preheader;
+                    pre.insert(pre.end() - 1, in[i]);
+                    in.erase(in.begin() + i);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void eliminateDeadCode(IRFunction * f)
+{
+    set<IRInstr *> live;
+    vector<IRInstr *> work;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        for (size_t i = 0; i < f->blocks[k]->instrs.size(); ++i)
+        {
+            IRInstr * in = f->blocks[k]->instrs[i];
+            if (in->hasEffects() || in->op == irParam)
+            {
+                live.insert(in);
+                work.push_back(in);
+            }
+        }
+    while (!work.empty())
+    {
+        IRInstr * in = work.back();
+        work.pop_back();
+        for (size_t j = 0; j < in->args.size(); ++j)
+            if (live.insert(in->args[j]).second)
+                work.push_back(in->args[j]);
+    }
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        vector<IRInstr *> & in = f->blocks[k]->instrs;
+        for (size_t i = 0; i < in.size(); )
+            if (live.count(in[i]))
+                ++i;
+            else
+                in.erase(in.begin() + i);
+    }
+}
+
+void optimizeIR(IRFunction * f)
+{
+    foldBranches(f);
+    removeUnreachable(f);
+    eliminateCommonSubexprs(f);
+    hoistLoopInvariants(f);
+    eliminateCommonSubexprs(f); // hoisted values now dominate more uses
+    eliminateDeadCode(f);
+}
+
+static void lowerProgram(IRModule * m, Stmt s, string prefix)
+{
+    if (DefStmt * def = dynamic_cast<DefStmt *>(s))
+    {
+        IRFunction * f = lowerToIR(def);
+        f->name = prefix + def->name;
+        m->add(f);
+        lowerProgram(m, def->body, f->name + ".");
+    }
+    else if (ClassStmt * cls = dynamic_cast<ClassStmt *>(s))
+    {
+        vector<string> & bases = m->bases[cls->name];
+        for (TypeList b = cls->bases; b; b = b->next)
+            bases.push_back(b->info->name);
+        if (IRFunction * f = lowerFields(cls))
+            m->add(f);
+        lowerProgram(m, cls->body, cls->name + ".");
+    }
+    else if (BlockStmt * bs = dynamic_cast<BlockStmt *>(s))
+        for (StmtList p = bs->stmts; p; p = p->next)
+            lowerProgram(m, p->info, prefix);
+}
+
+IRModule * lowerProgram(StmtList L)
+{
+    IRModule * m = new IRModule();
+    if (IRFunction * f = lowerMain(L))
+        m->add(f);
+    for (; L; L = L->next)
+        lowerProgram(m, L->info, "");
+    return m;
+}
+
+IRModule * compileProgram(StmtList L)
+{
+    IRModule * m = lowerProgram(L);
+    for (size_t i = 0; i < m->functions.size(); ++i)
+        optimizeIR(m->functions[i]);
+    inlineCalls(m);
+    for (size_t i = 0; i < m->functions.size(); ++i)
+        eliminateBoundsChecks(m->functions[i]);
+    countOpcodePairs(m);
+    for (size_t i = 0; i < m->functions.size(); ++i)
+        fuseSuperinstructions(m->functions[i]);
+    return m;
+}
+
+void dumpIR(ostream & out, IRModule * m)
+{
+    inlineStats.put(out);
+    boundsStats.put(out);
+    superStats.put(out);
+    for (size_t i = 0; i < m->functions.size(); ++i)
+        out << m->functions[i] << endl;
+}
@@ -0,0 +1,229 @@
+// *** MID-LEVEL IR ***
+//
+// A def body lowers to a control flow graph of IRBlocks in SSA form: every
+// IRInstr defines at most one value, locals and parameters become values
+// joined by phis, and globals, fields and list elements stay memory
+// operations.  The passes are
+//
+//     foldBranches      cbr on a constant becomes br
+//     removeUnreachable drops blocks the entry cannot reach
+//     eliminateCommonSubexprs  dominator-scoped value numbering of pure ops
+//     hoistLoopInvariants      pure, non-trapping ops out of while/for loops
+//     eliminateDeadCode        unused values, including dead local stores
+//
+// and put() prints the textual form used by -i.  inlineCalls (Inline.cpp)
+// then works over the whole program's IRModule, eliminateBoundsChecks
+// (Bounds.cpp) marks list accesses that cannot be out of range, and
+// fuseSuperinstructions (Super.cpp) rewrites the final IR into the fused
+// ops below.  compileProgram runs all of this; IRCache.cpp saves its
+// result so an unchanged program skips the front end, and runProgram
+// (Exec.cpp) runs it.
+
+enum IROp
+{
+    irConst, irStr, irNone, irParam, irPhi,
+    irAdd, irSub, irMul, irDiv, irMod, irNeg, irNot,
+    irEQ, irNE, irLT, irLE, irGT, irGE, irIs, irIsNot, irIn, irNotIn,
+    irLen, irGetIndex, irSetIndex, irGetField, irSetField, irGLoad, irGStore,
+    irList, irNew, irAlloc, irCall, irCallMethod, irPrint, irInput,
+    irBr, irCbr, irRet,
+    irAddImm,  // args[0] + imm, from add/sub with a constant
+    irCmpBr,   // cbr on comparison imm of args[0], args[1]
+    irPrintStr // print of the str constant name
+};
+
+const char * opName(IROp op);
+
+struct IRBlock;
+
+struct IRInstr
+{
+    IROp op;
+    int id;                  // value number, -1 if it defines none
+    vector<IRInstr *> args;
+    vector<IRBlock *> targets; // br/cbr successors; for a phi, the pred of each arg
+    long long imm;           // irConst value
+    string name;             // irStr text, global, field, callee or class
+    Type type;               // irParam: the declared type; irConst: BoolType for a bool;
+                             // irList: the checked element type
+    bool inRange;            // getindex/setindex: index proven in bounds
+    int row;                 // source row of the statement it came from, or -1
+    IRBlock * block;
+    IRInstr * replacement;   // set when a trivial phi is folded away
+
+    IRInstr(IROp o, int i)
+        : op(o), id(i), imm(0), type(0), inRange(false), row(-1), block(0), replacement(0)
+    {
+    }
+
+    bool isTerminator() { return op == irBr || op == irCbr || op == irRet || op == irCmpBr; }
+    bool isPure();      // same operands, same result, no effects
+    bool mayTrap();     // could raise at run time
+    bool hasEffects();  // must be kept even if unused
+
+    void put(ostream & out);
+};
+
+struct IRBlock
+{
+    int id;
+    vector<IRInstr *> instrs;
+    vector<IRBlock *> preds;
+    vector<IRBlock *> succs;
+    bool sealed;           // all preds known, see IRBuilder
+    IRBlock * idom;        // immediate dominator
+    int order;             // reverse postorder index, -1 if unreachable
+
+    IRBlock(int i)
+        : id(i), sealed(false), idom(0), order(-1)
+    {
+    }
+
+    IRInstr * terminator()
+    {
+        return instrs.empty() || !instrs.back()->isTerminator() ? 0 : instrs.back();
+    }
+};
+
+struct IRFunction
+{
+    string name;
+    vector<IRInstr *> params;
+    vector<IRBlock *> blocks; // blocks[0] is the entry
+    int nextValue;
+    int nextBlock;
+
+    IRFunction(string nm)
+        : name(nm), nextValue(0), nextBlock(0)
+    {
+    }
+
+    IRBlock * newBlock()
+    {
+        IRBlock * b = new IRBlock(nextBlock++);
+        blocks.push_back(b);
+        return b;
+    }
+
+    void put(ostream & out);
+};
+
+inline ostream & operator << (ostream & out, IRFunction * f)
+{
+    f->put(out);
+    return out;
+}
+
+// Every def of a program; methods are named Class.method and nested defs
+// outer.inner.  The top-level statements are the def MAIN_NAME, and the
+// attribute initializers of a class C the def C.FIELDS_NAME(self), run on
+// each new object of C or a subclass before its __init__.
+struct IRModule
+{
+    vector<IRFunction *> functions;
+    map<string, IRFunction *> byName;
+    map<string, vector<string> > bases; // every class, to its bases' names in order
+    bool qualified; // each call names its callee in full, see qualifyCalls
+
+    IRModule()
+        : qualified(false)
+    {
+    }
+
+    void add(IRFunction * f)
+    {
+        functions.push_back(f);
+        byName[f->name] = f;
+    }
+
+    IRFunction * methodFor(string cls, string name); // through the bases, depth first
+    IRFunction * constructorFor(string cls); // __init__ run by new cls
+    IRFunction * functionFor(string caller, string name); // what name calls from caller
+};
+
+struct InlineStats
+{
+    int sites;   // statically bound call and new sites seen
+    int inlined;
+    vector<string> report; // "caller: callee" per inlined site
+
+    InlineStats()
+        : sites(0), inlined(0)
+    {
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** Inlining: " << inlined << " of " << sites << " sites ***" << endl;
+        for (size_t i = 0; i < report.size(); ++i)
+            out << report[i] << endl;
+    }
+};
+
+// The most frequent producer-consumer opcode pairs of a program, which
+// pick the superinstructions, and how often each fusion applied.
+struct SuperStats
+{
+    map<string, long> pairs; // "add cbr": an add used by the next instruction
+    int addImm, cmpBr, printStr;
+
+    SuperStats()
+        : addImm(0), cmpBr(0), printStr(0)
+    {
+    }
+
+    void put(ostream & out); // the ten most frequent pairs and the fusions
+};
+
+extern SuperStats superStats;
+
+struct BoundsStats
+{
+    int checks;     // getindex and setindex seen
+    int eliminated; // of those, proven in range
+
+    BoundsStats()
+        : checks(0), eliminated(0)
+    {
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** Bounds Checks ***" << endl;
+        out << "checks " << checks << " eliminated " << eliminated << endl;
+    }
+};
+
+extern BoundsStats boundsStats;
+
+extern bool irDump;      // print each def's optimized IR after checking (-i)
+extern const char * irCacheFile; // where -k keeps the compiled IR
+extern unsigned long long irSourceHash; // of the source read for -k
+extern int inlineBudget; // largest callee, in instructions, to inline (-b)
+extern InlineStats inlineStats;
+
+IRFunction * lowerToIR(DefStmt * def);
+IRModule * lowerProgram(StmtList L);
+void optimizeIR(IRFunction * f);
+void qualifyCalls(IRModule * m); // each called name becomes its callee's full name
+void inlineCalls(IRModule * m);
+void eliminateBoundsChecks(IRFunction * f);
+void countOpcodePairs(IRModule * m);
+void fuseSuperinstructions(IRFunction * f);
+IRModule * compileProgram(StmtList L); // lower, optimize, inline and fuse
+void dumpIR(ostream & out, IRModule * m); // the pass statistics, then each def
+void resolveOperands(IRFunction * f);   // rewrite operands through replacements
+
+// IRCache.cpp: the final IRModule of a source, with what the front end
+// printed for it, reloaded when the source hash and the build and flags
+// match (-k).  readIRCache returns 0 for a missing, stale or bad file.
+unsigned long long sourceHash(const string & source);
+bool writeIRCache(const string & path, IRModule * m, unsigned long long hash, const string & output);
+IRModule * readIRCache(const string & path, unsigned long long hash, string & output);
+
+void foldBranches(IRFunction * f);
+void removeUnreachable(IRFunction * f);
+void computeDominators(IRFunction * f);
+void eliminateCommonSubexprs(IRFunction * f);
+void hoistLoopInvariants(IRFunction * f);
+void eliminateDeadCode(IRFunction * f);
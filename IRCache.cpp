@@ -0,0 +1,416 @@
+#include "all.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+// *** IR CACHE FILES ***
+//
+// A cache file holds the final IRModule of a program, so a rerun of the
+// same source can skip lexing, parsing, checking and the passes.  It is
+// a sequence of 32-bit words (constants are 64-bit):
+//
+//     header     magic, version, source hash, build and flags hash, byte
+//                size, the counts of each table below and the str index
+//                of the front end's output
+//     int pool   every imm, once each
+//     str pool   every name and str constant, once each, as a length and
+//                the bytes padded to a word; entry 0 is ""
+//     classes    each class, its number of bases and their names, as str
+//                indices
+//     functions  name, nextValue, nextBlock, the param value ids, then
+//                each block: its preds and succs as block indices and its
+//                instrs as op, id, flags, row, imm index, name index, arg
+//                value ids and target block indices
+//
+// The version includes the number of IROps, and the config hash covers
+// the compiler binary itself (its size and modification time), the mode
+// (-5 or -6) and the flags that change the IR or the output (-b, -e, -i),
+// so a rebuilt compiler or a differently configured run rejects old
+// files.  A file whose hashes, version or size do not match is ignored
+// and rewritten.
+//
+// Only a run that reported no diagnostics is cached.  The output kept is
+// everything the front end printed to cout (FrontEnd.h), the scope dumps
+// of -5 included, and a hit prints it again, so a hit prints what a miss
+// would; under -6 the hit then runs the cached IR.
+
+const char * irCacheFile = 0;
+unsigned long long irSourceHash = 0;
+
+static const unsigned CACHE_MAGIC = 0x52495950; // "PYIR"
+static const unsigned CACHE_FORMAT = 4;         // bump when the layout changes
+static const unsigned CACHE_VERSION = CACHE_FORMAT << 16 | (irPrintStr + 1);
+
+struct CacheHeader
+{
+    unsigned magic, version;
+    unsigned long long hash, config, size;
+    unsigned ints, strs, classes, functions;
+    unsigned qualified; // IRModule::qualified
+    unsigned output;    // str index of what the front end printed
+};
+
+unsigned long long sourceHash(const string & source)
+{
+    unsigned long long h = 14695981039346656037ULL; // FNV-1a
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        h ^= (unsigned char) source[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// The running compiler's build and the flags a cached run depends on.
+static unsigned long long cacheConfig()
+{
+    ostringstream config;
+    struct stat st;
+    if (stat("/proc/self/exe", &st) == 0)
+        config << st.st_size << ' ' << st.st_mtime << ' ';
+    config << __VERSION__ << " -" << HW << " -b" << inlineBudget << (escapeReport ? " -e" : "") << (irDump ? " -i" : "");
+    return sourceHash(config.str());
+}
+
+// Type codes for irParam, irConst and irList: only what an engine tests is
+// kept.
+static unsigned typeCode(Type ty)
+{
+    if (!ty)
+        return 0;
+    if (ty->behavior(isAny))
+        return 'a';
+    if (ty->behavior(isBool))
+        return 'b';
+    if (ty->behavior(isInt))
+        return 'i';
+    if (ty->behavior(isStr))
+        return 's';
+    return 0;
+}
+
+static Type typeFor(unsigned code)
+{
+    switch (code)
+    {
+        case 'a': return AnyType::make();
+        case 'b': return BoolType::make();
+        case 'i': return IntType::make();
+        case 's': return StrType::make();
+        default: return 0;
+    }
+}
+
+struct CacheWriter
+{
+    vector<unsigned> body;
+    vector<long long> ints;
+    vector<string> strs;
+    map<long long, unsigned> intIndex;
+    map<string, unsigned> strIndex;
+
+    CacheWriter()
+    {
+        str("");
+    }
+
+    unsigned imm(long long v)
+    {
+        map<long long, unsigned>::iterator p = intIndex.find(v);
+        if (p != intIndex.end())
+            return p->second;
+        ints.push_back(v);
+        return intIndex[v] = ints.size() - 1;
+    }
+
+    unsigned str(const string & s)
+    {
+        map<string, unsigned>::iterator p = strIndex.find(s);
+        if (p != strIndex.end())
+            return p->second;
+        strs.push_back(s);
+        return strIndex[s] = strs.size() - 1;
+    }
+
+    void word(unsigned w) { body.push_back(w); }
+
+    void function(IRFunction * f)
+    {
+        map<IRBlock *, unsigned> index;
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+            index[f->blocks[k]] = k;
+        word(str(f->name));
+        word(f->nextValue);
+        word(f->nextBlock);
+        word(f->params.size());
+        for (size_t i = 0; i < f->params.size(); ++i)
+            word(f->params[i]->id);
+        word(f->blocks.size());
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+        {
+            IRBlock * b = f->blocks[k];
+            word(b->id);
+            word(b->preds.size());
+            for (size_t i = 0; i < b->preds.size(); ++i)
+                word(index[b->preds[i]]);
+            word(b->succs.size());
+            for (size_t i = 0; i < b->succs.size(); ++i)
+                word(index[b->succs[i]]);
+            word(b->instrs.size());
+            for (size_t j = 0; j < b->instrs.size(); ++j)
+            {
+                IRInstr * in = b->instrs[j];
+                word(in->op);
+                word(in->id);
+                word(in->inRange | typeCode(in->type) << 8);
+                word(in->row);
+                word(imm(in->imm));
+                word(str(in->name));
+                word(in->args.size());
+                for (size_t i = 0; i < in->args.size(); ++i)
+                    word(in->args[i]->id);
+                word(in->targets.size());
+                for (size_t i = 0; i < in->targets.size(); ++i)
+                    word(index[in->targets[i]]);
+            }
+        }
+    }
+};
+
+bool writeIRCache(const string & path, IRModule * m, unsigned long long hash, const string & output)
+{
+    CacheWriter w;
+    unsigned outputIndex = w.str(output);
+    for (map<string, vector<string> >::iterator p = m->bases.begin(); p != m->bases.end(); ++p)
+    {
+        w.word(w.str(p->first));
+        w.word(p->second.size());
+        for (size_t i = 0; i < p->second.size(); ++i)
+            w.word(w.str(p->second[i]));
+    }
+    for (size_t i = 0; i < m->functions.size(); ++i)
+        w.function(m->functions[i]);
+
+    vector<unsigned> strWords;
+    for (size_t i = 0; i < w.strs.size(); ++i)
+    {
+        const string & s = w.strs[i];
+        strWords.push_back(s.size());
+        size_t at = strWords.size();
+        strWords.resize(at + (s.size() + 3) / 4);
+        if (!s.empty())
+            memcpy(&strWords[at], s.data(), s.size());
+    }
+
+    CacheHeader h = CacheHeader(); // zeroed, padding included
+    h.magic = CACHE_MAGIC;
+    h.version = CACHE_VERSION;
+    h.hash = hash;
+    h.config = cacheConfig();
+    h.output = outputIndex;
+    h.ints = w.ints.size();
+    h.strs = w.strs.size();
+    h.classes = m->bases.size();
+    h.qualified = m->qualified;
+    h.functions = m->functions.size();
+    h.size = sizeof h + 8 * w.ints.size() + 4 * (strWords.size() + w.body.size());
+
+    string tmp = path + ".tmp"; // renamed into place, so readers never see half a file
+    ofstream out(tmp.c_str(), ios::binary);
+    out.write((const char *) &h, sizeof h);
+    if (!w.ints.empty())
+        out.write((const char *) &w.ints[0], 8 * w.ints.size());
+    if (!strWords.empty())
+        out.write((const char *) &strWords[0], 4 * strWords.size());
+    if (!w.body.empty())
+        out.write((const char *) &w.body[0], 4 * w.body.size());
+    out.close();
+    if (!out || rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Reads the mapped words; any count or index out of range marks the file
+// bad instead of reading past it.
+struct CacheReader
+{
+    const unsigned * at;
+    const unsigned * end;
+    const long long * ints;
+    vector<string> strs;
+    CacheHeader h;
+    bool bad;
+
+    unsigned word()
+    {
+        if (at == end)
+        {
+            bad = true;
+            return 0;
+        }
+        return *at++;
+    }
+
+    unsigned count(size_t limit) // a word that must be below limit
+    {
+        unsigned n = word();
+        if (n >= limit)
+        {
+            bad = true;
+            return 0;
+        }
+        return n;
+    }
+
+    const string & str()
+    {
+        static const string none;
+        unsigned i = count(strs.size());
+        return bad ? none : strs[i];
+    }
+
+    long long imm()
+    {
+        unsigned i = count(h.ints);
+        return bad ? 0 : ints[i];
+    }
+
+    bool strPool()
+    {
+        for (unsigned i = 0; i < h.strs && !bad; ++i)
+        {
+            size_t n = word();
+            size_t words = (n + 3) / 4;
+            if (words > size_t(end - at))
+                return bad = true, false;
+            strs.push_back(string((const char *) at, n));
+            at += words;
+        }
+        return !bad;
+    }
+
+    IRFunction * function()
+    {
+        IRFunction * f = new IRFunction(str());
+        f->nextValue = word();
+        f->nextBlock = word();
+        if (bad || f->nextValue < 0 || f->nextValue > end - at)
+            return bad = true, f;
+        vector<IRInstr *> values(f->nextValue);
+        vector<unsigned> params(count(values.size() + 1));
+        for (size_t i = 0; i < params.size() && !bad; ++i)
+            params[i] = count(values.size());
+        vector<IRBlock *> blocks(count(end - at + 1));
+        for (size_t k = 0; k < blocks.size(); ++k)
+            blocks[k] = new IRBlock(0);
+        f->blocks = blocks;
+
+        vector<pair<IRInstr *, unsigned> > args; // operand value ids, resolved at the end
+        for (size_t k = 0; k < blocks.size() && !bad; ++k)
+        {
+            IRBlock * b = blocks[k];
+            b->id = word();
+            b->sealed = true;
+            b->preds.resize(count(blocks.size() + 1));
+            for (size_t i = 0; i < b->preds.size(); ++i)
+                b->preds[i] = blocks[count(blocks.size())];
+            b->succs.resize(count(blocks.size() + 1));
+            for (size_t i = 0; i < b->succs.size(); ++i)
+                b->succs[i] = blocks[count(blocks.size())];
+            size_t n = count(end - at + 1);
+            for (size_t j = 0; j < n && !bad; ++j)
+            {
+                IROp op = IROp(count(irPrintStr + 1));
+                int id = word();
+                IRInstr * in = new IRInstr(op, id);
+                in->block = b;
+                b->instrs.push_back(in);
+                if (id >= 0)
+                {
+                    if (size_t(id) >= values.size() || values[id])
+                        return bad = true, f;
+                    values[id] = in;
+                }
+                unsigned flags = word();
+                in->inRange = flags & 1;
+                in->type = typeFor(flags >> 8);
+                in->row = word();
+                in->imm = imm();
+                in->name = str();
+                size_t nArgs = count(end - at + 1);
+                for (size_t i = 0; i < nArgs; ++i)
+                    args.push_back(make_pair(in, count(values.size())));
+                in->targets.resize(count(blocks.size() + 1));
+                for (size_t i = 0; i < in->targets.size(); ++i)
+                    in->targets[i] = blocks[count(blocks.size())];
+            }
+        }
+        for (size_t i = 0; i < args.size() && !bad; ++i)
+        {
+            IRInstr * v = values[args[i].second];
+            if (!v)
+                return bad = true, f;
+            args[i].first->args.push_back(v);
+        }
+        for (size_t i = 0; i < params.size() && !bad; ++i)
+            if (values[params[i]])
+                f->params.push_back(values[params[i]]);
+            else
+                bad = true;
+        return f;
+    }
+};
+
+IRModule * readIRCache(const string & path, unsigned long long hash, string & output)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(CacheHeader))
+    {
+        close(fd);
+        return 0;
+    }
+    size_t size = st.st_size;
+    void * p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return 0;
+
+    CacheReader r;
+    memcpy(&r.h, p, sizeof r.h);
+    IRModule * m = 0;
+    if (r.h.magic == CACHE_MAGIC && r.h.version == CACHE_VERSION && r.h.hash == hash
+        && r.h.config == cacheConfig() && r.h.size == size && r.h.ints <= (size - sizeof r.h) / 8)
+    {
+        const char * base = (const char *) p + sizeof r.h;
+        r.ints = (const long long *) base;
+        r.at = (const unsigned *) (base + 8 * r.h.ints);
+        r.end = (const unsigned *) ((const char *) p + size);
+        r.bad = false;
+        m = new IRModule;
+        if (r.strPool())
+            for (unsigned i = 0; i < r.h.classes && !r.bad; ++i)
+            {
+                vector<string> & bases = m->bases[r.str()];
+                bases.resize(r.count(r.end - r.at + 1));
+                for (size_t k = 0; k < bases.size(); ++k)
+                    bases[k] = r.str();
+            }
+        m->qualified = r.h.qualified;
+        if (r.h.output < r.strs.size())
+            output = r.strs[r.h.output];
+        else
+            r.bad = true;
+        for (unsigned i = 0; i < r.h.functions && !r.bad; ++i)
+            m->add(r.function());
+        if (r.bad || r.at != r.end)
+            m = 0; // the partial module is left to the process, as the passes leave their garbage
+    }
+    munmap(p, size);
+    return m;
+}
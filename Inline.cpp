@@ -0,0 +1,381 @@
+#include "all.h"
+
+// *** INLINING ***
+//
+// Calls to defs by name and object constructions are inlined into their
+// callers when the callee has at most inlineBudget instructions and is not
+// recursive.  Callees are visited before their callers, so a caller takes
+// in a callee with its own small calls already inlined.  A new C(...)
+// becomes an alloc followed by the body of the __init__ it runs, with self
+// bound to the alloc.  Method calls through an object stay calls: the IR
+// does not know the receiver's class.
+
+int inlineBudget = 40;
+InlineStats inlineStats;
+
+IRFunction * IRModule :: methodFor(string cls, string name)
+{
+    map<string, IRFunction *>::iterator f = byName.find(cls + "." + name);
+    if (f != byName.end())
+        return f->second;
+    vector<string> & b = bases[cls];
+    for (size_t i = 0; i < b.size(); ++i)
+        if (b[i] != cls) // the checker rejects cycles; this guards the direct one
+            if (IRFunction * m = methodFor(b[i], name))
+                return m;
+    return 0;
+}
+
+IRFunction * IRModule :: constructorFor(string cls)
+{
+    return methodFor(cls, CONSTRUCTOR_NAME);
+}
+
+// A bare name in a def is first one of its own nested defs, then one
+// nested in each enclosing def, outward, and last a top-level def.  A class
+// body is not a scope for the defs inside it: a method calls another
+// method through self.
+IRFunction * IRModule :: functionFor(string caller, string name)
+{
+    for (string scope = caller; !scope.empty(); )
+    {
+        if (!bases.count(scope))
+        {
+            map<string, IRFunction *>::iterator f = byName.find(scope + "." + name);
+            if (f != byName.end())
+                return f->second;
+        }
+        size_t dot = scope.rfind('.');
+        scope = dot == string::npos ? "" : scope.substr(0, dot);
+    }
+    map<string, IRFunction *>::iterator f = byName.find(name);
+    return f == byName.end() ? 0 : f->second;
+}
+
+// The def an irCall or irNew runs, or 0 if it is not known statically.
+static IRFunction * calleeOf(IRModule * m, IRFunction * caller, IRInstr * in)
+{
+    if (in->op == irNew)
+        return m->constructorFor(in->name);
+    if (in->op != irCall || in->name.empty())
+        return 0;
+    if (!m->qualified)
+        return m->functionFor(caller->name, in->name);
+    map<string, IRFunction *>::iterator f = m->byName.find(in->name);
+    return f == m->byName.end() ? 0 : f->second;
+}
+
+static int size(IRFunction * f)
+{
+    int n = 0;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        n += f->blocks[k]->instrs.size();
+    return n;
+}
+
+typedef map<IRFunction *, set<IRFunction *> > CallGraph;
+
+static CallGraph buildCallGraph(IRModule * m)
+{
+    CallGraph g;
+    for (size_t i = 0; i < m->functions.size(); ++i)
+    {
+        IRFunction * f = m->functions[i];
+        set<IRFunction *> & callees = g[f];
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+            for (size_t j = 0; j < f->blocks[k]->instrs.size(); ++j)
+                if (IRFunction * c = calleeOf(m, f, f->blocks[k]->instrs[j]))
+                    callees.insert(c);
+    }
+    return g;
+}
+
+static bool reaches(CallGraph & g, IRFunction * from, IRFunction * to, set<IRFunction *> & seen)
+{
+    set<IRFunction *> & callees = g[from];
+    for (set<IRFunction *>::iterator c = callees.begin(); c != callees.end(); ++c)
+        if (*c == to || (seen.insert(*c).second && reaches(g, *c, to, seen)))
+            return true;
+    return false;
+}
+
+static void postorder(CallGraph & g, IRFunction * f, set<IRFunction *> & seen, vector<IRFunction *> & order)
+{
+    seen.insert(f);
+    set<IRFunction *> & callees = g[f];
+    for (set<IRFunction *>::iterator c = callees.begin(); c != callees.end(); ++c)
+        if (!seen.count(*c))
+            postorder(g, *c, seen, order);
+    order.push_back(f);
+}
+
+// Moves b's instructions from i on into a new block that takes over b's
+// successors, leaving b without a terminator.
+static IRBlock * splitBlock(IRFunction * f, IRBlock * b, size_t i)
+{
+    IRBlock * cont = f->newBlock();
+    cont->sealed = true;
+    cont->instrs.assign(b->instrs.begin() + i, b->instrs.end());
+    b->instrs.resize(i);
+    for (size_t j = 0; j < cont->instrs.size(); ++j)
+        cont->instrs[j]->block = cont;
+    cont->succs = b->succs;
+    b->succs.clear();
+    for (size_t s = 0; s < cont->succs.size(); ++s)
+    {
+        IRBlock * succ = cont->succs[s];
+        replace(succ->preds.begin(), succ->preds.end(), b, cont);
+        for (size_t k = 0; k < succ->instrs.size() && succ->instrs[k]->op == irPhi; ++k)
+            replace(succ->instrs[k]->targets.begin(), succ->instrs[k]->targets.end(), b, cont);
+    }
+    return cont;
+}
+
+static IRInstr * append(IRFunction * f, IRBlock * b, IROp op)
+{
+    IRInstr * in = new IRInstr(op, op == irBr ? -1 : f->nextValue++);
+    in->block = b;
+    b->instrs.push_back(in);
+    return in;
+}
+
+// Replaces the call at b->instrs[i] by a copy of callee's body, with the
+// params bound to args.  The call's uses see the returned value, or
+// result if one is given.  Returns the copied blocks.
+static set<IRBlock *> inlineCall(IRFunction * f, IRBlock * b, size_t i, IRFunction * callee,
+                                 vector<IRInstr *> args, IRInstr * result)
+{
+    IRInstr * call = b->instrs[i];
+    b->instrs.erase(b->instrs.begin() + i);
+    IRBlock * cont = splitBlock(f, b, i);
+
+    map<IRBlock *, IRBlock *> blockMap;
+    map<IRInstr *, IRInstr *> valueMap;
+    set<IRBlock *> copied;
+    for (size_t k = 0; k < callee->params.size(); ++k)
+        valueMap[callee->params[k]] = args[k];
+    for (size_t k = 0; k < callee->blocks.size(); ++k)
+    {
+        IRBlock * nb = f->newBlock();
+        nb->sealed = true;
+        blockMap[callee->blocks[k]] = nb;
+        copied.insert(nb);
+    }
+    for (size_t k = 0; k < callee->blocks.size(); ++k)
+    {
+        vector<IRInstr *> & in = callee->blocks[k]->instrs;
+        for (size_t j = 0; j < in.size(); ++j)
+            if (in[j]->op != irParam)
+            {
+                IRInstr * c = new IRInstr(in[j]->op, in[j]->id < 0 ? -1 : f->nextValue++);
+                c->imm = in[j]->imm;
+                c->name = in[j]->name;
+                c->type = in[j]->type;
+                c->row = in[j]->row;
+                c->block = blockMap[callee->blocks[k]];
+                c->block->instrs.push_back(c);
+                valueMap[in[j]] = c;
+            }
+    }
+
+    // operands and edges, now that every value has its copy
+    vector<pair<IRBlock *, IRInstr *> > returns;
+    for (size_t k = 0; k < callee->blocks.size(); ++k)
+    {
+        IRBlock * ob = callee->blocks[k];
+        IRBlock * nb = blockMap[ob];
+        for (size_t s = 0; s < ob->preds.size(); ++s)
+            nb->preds.push_back(blockMap[ob->preds[s]]);
+        for (size_t s = 0; s < ob->succs.size(); ++s)
+            nb->succs.push_back(blockMap[ob->succs[s]]);
+        size_t j = 0;
+        for (size_t oj = 0; oj < ob->instrs.size(); ++oj)
+        {
+            IRInstr * o = ob->instrs[oj];
+            if (o->op == irParam)
+                continue;
+            IRInstr * c = nb->instrs[j++];
+            for (size_t a = 0; a < o->args.size(); ++a)
+                c->args.push_back(valueMap[o->args[a]]);
+            for (size_t t = 0; t < o->targets.size(); ++t)
+                c->targets.push_back(blockMap[o->targets[t]]);
+            if (c->op == irRet)
+            {
+                IRInstr * value = c->args.empty() ? 0 : c->args[0];
+                c->op = irBr;
+                c->args.clear();
+                c->targets.assign(1, cont);
+                nb->succs.assign(1, cont);
+                cont->preds.push_back(nb);
+                if (!value && !result)
+                {
+                    nb->instrs.pop_back();
+                    value = append(f, nb, irNone);
+                    nb->instrs.push_back(c);
+                }
+                returns.push_back(make_pair(nb, value));
+            }
+        }
+    }
+
+    IRBlock * entry = blockMap[callee->blocks[0]];
+    IRInstr * jump = append(f, b, irBr);
+    jump->targets.push_back(entry);
+    b->succs.push_back(entry);
+    entry->preds.push_back(b);
+
+    if (!result && returns.size() == 1)
+        result = returns[0].second;
+    else if (!result)
+    {
+        result = new IRInstr(returns.empty() ? irNone : irPhi, f->nextValue++);
+        result->block = cont;
+        for (size_t r = 0; r < returns.size(); ++r)
+        {
+            result->args.push_back(returns[r].second);
+            result->targets.push_back(returns[r].first);
+        }
+        cont->instrs.insert(cont->instrs.begin(), result);
+    }
+    call->replacement = result;
+    return copied;
+}
+
+// Splicing leaves blocks that only jump to a block with no other pred;
+// each such pair is merged into one.
+static void mergeBlocks(IRFunction * f)
+{
+    set<IRBlock *> merged;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        IRBlock * b = f->blocks[k];
+        while (!merged.count(b) && b->terminator() && b->terminator()->op == irBr
+               && b->succs[0]->preds.size() == 1 && b->succs[0] != b)
+        {
+            IRBlock * next = b->succs[0];
+            b->instrs.pop_back();
+            for (size_t i = 0; i < next->instrs.size(); ++i)
+            {
+                IRInstr * in = next->instrs[i];
+                if (in->op == irPhi)
+                    in->replacement = in->args[0];
+                else
+                {
+                    in->block = b;
+                    b->instrs.push_back(in);
+                }
+            }
+            b->succs = next->succs;
+            for (size_t s = 0; s < b->succs.size(); ++s)
+            {
+                IRBlock * succ = b->succs[s];
+                replace(succ->preds.begin(), succ->preds.end(), next, b);
+                for (size_t i = 0; i < succ->instrs.size() && succ->instrs[i]->op == irPhi; ++i)
+                    replace(succ->instrs[i]->targets.begin(), succ->instrs[i]->targets.end(), next, b);
+            }
+            merged.insert(next);
+        }
+    }
+    vector<IRBlock *> live;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        if (!merged.count(f->blocks[k]))
+            live.push_back(f->blocks[k]);
+    f->blocks = live;
+    resolveOperands(f);
+}
+
+static void inlineCalls(IRModule * m, IRFunction * f, CallGraph & g)
+{
+    set<IRBlock *> copied; // callee bodies: their calls were already considered
+    bool changed = false;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        IRBlock * b = f->blocks[k];
+        if (copied.count(b))
+            continue;
+        for (size_t i = 0; i < b->instrs.size(); ++i)
+        {
+            IRInstr * in = b->instrs[i];
+            if (in->op != irCall && in->op != irNew)
+                continue;
+            IRFunction * callee = calleeOf(m, f, in);
+            if (!callee && !(in->op == irNew && in->args.empty()))
+                continue;
+            ++inlineStats.sites;
+            set<IRFunction *> seen;
+            size_t arity = in->args.size() + (in->op == irNew);
+            if (callee && (callee == f || callee->params.size() != arity
+                           || size(callee) > inlineBudget || reaches(g, callee, callee, seen)))
+                continue;
+
+            vector<IRInstr *> args = in->args;
+            IRInstr * result = 0;
+            if (in->op == irNew)
+            {
+                result = new IRInstr(irAlloc, f->nextValue++);
+                result->name = in->name;
+                result->block = b;
+                b->instrs.insert(b->instrs.begin() + i, result);
+                args.insert(args.begin(), result);
+                ++i;
+                if (!callee)
+                {
+                    in->replacement = result;
+                    b->instrs.erase(b->instrs.begin() + i);
+                    --i;
+                    ++inlineStats.inlined;
+                    inlineStats.report.push_back(f->name + ": new " + in->name);
+                    changed = true;
+                    continue;
+                }
+            }
+            set<IRBlock *> body = inlineCall(f, b, i, callee, args, result);
+            copied.insert(body.begin(), body.end());
+            ++inlineStats.inlined;
+            inlineStats.report.push_back(f->name + ": " + callee->name);
+            changed = true;
+            break; // the rest of b moved to a new block, scanned later
+        }
+    }
+    if (changed)
+    {
+        resolveOperands(f);
+        mergeBlocks(f);
+        optimizeIR(f);
+    }
+}
+
+// Replaces each called name by the full name of the def it resolves to,
+// so the call means the same after it is inlined into another def.  A
+// name is resolved only once: afterwards it is looked up as it stands.
+void qualifyCalls(IRModule * m)
+{
+    if (m->qualified)
+        return;
+    for (size_t i = 0; i < m->functions.size(); ++i)
+    {
+        IRFunction * f = m->functions[i];
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+            for (size_t j = 0; j < f->blocks[k]->instrs.size(); ++j)
+            {
+                IRInstr * in = f->blocks[k]->instrs[j];
+                if (in->op == irCall)
+                    if (IRFunction * callee = calleeOf(m, f, in))
+                        in->name = callee->name;
+            }
+    }
+    m->qualified = true;
+}
+
+void inlineCalls(IRModule * m)
+{
+    qualifyCalls(m);
+    CallGraph g = buildCallGraph(m);
+    vector<IRFunction *> order;
+    set<IRFunction *> seen;
+    for (size_t i = 0; i < m->functions.size(); ++i)
+        if (!seen.count(m->functions[i]))
+            postorder(g, m->functions[i], seen, order);
+    for (size_t i = 0; i < order.size(); ++i)
+        inlineCalls(m, order[i], g);
+}
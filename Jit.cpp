@@ -0,0 +1,332 @@
+#include "all.h"
+#include <sys/mman.h>
+#include <cstring>
+
+int jitThreshold = 1000;
+JitStats jitStats;
+
+static bool isIntType(Type ty)
+{
+    return ty && !ty->behavior(isAny) && (ty->behavior(isInt) || ty->behavior(isBool));
+}
+
+enum { kindInt = 1, kindBool = 2, kindMixed = kindInt | kindBool };
+
+// The kind of each value, to know what Value the result becomes: bools
+// and ints are both 0/1 words in the code.  A phi is every kind that
+// reaches it, found by iterating to a fixed point.
+static int resultKind(IRFunction * f)
+{
+    map<IRInstr *, int> kind;
+    for (bool changed = true; changed; )
+    {
+        changed = false;
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+            for (size_t i = 0; i < f->blocks[k]->instrs.size(); ++i)
+            {
+                IRInstr * in = f->blocks[k]->instrs[i];
+                int n = kindInt;
+                switch (in->op)
+                {
+                    case irConst: case irParam:
+                        n = in->type && in->type->behavior(isBool) ? kindBool : kindInt;
+                        break;
+                    case irNot: case irEQ: case irNE: case irLT: case irLE: case irGT: case irGE:
+                        n = kindBool;
+                        break;
+                    case irPhi:
+                        n = 0;
+                        for (size_t j = 0; j < in->args.size(); ++j)
+                            n |= kind[in->args[j]];
+                        break;
+                    default:
+                        break;
+                }
+                if (kind[in] != n)
+                {
+                    kind[in] = n;
+                    changed = true;
+                }
+            }
+    }
+    int result = 0;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        IRInstr * t = f->blocks[k]->terminator();
+        if (t && t->op == irRet && !t->args.empty())
+            result |= kind[t->args[0]];
+    }
+    return result;
+}
+
+static bool supported(IRFunction * f)
+{
+    if (f->params.size() > 6)
+        return false;
+    for (size_t i = 0; i < f->params.size(); ++i)
+        if (!isIntType(f->params[i]->type))
+            return false;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        for (size_t i = 0; i < f->blocks[k]->instrs.size(); ++i)
+        {
+            IRInstr * in = f->blocks[k]->instrs[i];
+            switch (in->op)
+            {
+                case irConst: case irParam: case irPhi:
+                case irAdd: case irSub: case irMul: case irNeg: case irNot:
+                case irEQ: case irNE: case irLT: case irLE: case irGT: case irGE:
+                case irBr: case irCbr: case irAddImm: case irCmpBr:
+                    break;
+                case irRet:
+                    if (in->args.empty())
+                        return false;
+                    break;
+                default:
+                    return false;
+            }
+        }
+    return true;
+}
+
+// Machine code for one def, in the order the templates are stitched.
+// Label 0 is the overflow exit.
+struct Emitter
+{
+    vector<unsigned char> code;
+    map<IRBlock *, size_t> labels;
+    vector<pair<size_t, IRBlock *> > fixups; // rel32 fields to patch
+
+    void bytes(const char * b, size_t n)
+    {
+        code.insert(code.end(), (const unsigned char *) b, (const unsigned char *) b + n);
+    }
+
+    void int32(int v)
+    {
+        bytes((const char *) &v, 4);
+    }
+
+    static int slot(IRInstr * v)
+    {
+        return -8 * (v->id + 1);
+    }
+
+    void load(const char * op, IRInstr * v) // mov rax/rcx, [rbp + slot]
+    {
+        bytes(op, 3);
+        int32(slot(v));
+    }
+
+    void loadRax(IRInstr * v) { load("\x48\x8b\x85", v); }
+    void loadRcx(IRInstr * v) { load("\x48\x8b\x8d", v); }
+    void storeRax(IRInstr * v) { load("\x48\x89\x85", v); }
+
+    void jump(const char * op, size_t n, IRBlock * to)
+    {
+        bytes(op, n);
+        fixups.push_back(make_pair(code.size(), to));
+        int32(0);
+    }
+
+    // Copies the phi inputs for the edge from -> to.  All are pushed before
+    // any is popped, so phis reading each other see the old values.
+    void phiMoves(IRBlock * from, IRBlock * to)
+    {
+        vector<IRInstr *> phis;
+        for (size_t i = 0; i < to->instrs.size() && to->instrs[i]->op == irPhi; ++i)
+        {
+            IRInstr * phi = to->instrs[i];
+            for (size_t j = 0; j < phi->targets.size(); ++j)
+                if (phi->targets[j] == from)
+                {
+                    bytes("\xff\xb5", 2); // push [rbp + slot]
+                    int32(slot(phi->args[j]));
+                    phis.push_back(phi);
+                    break;
+                }
+        }
+        for (size_t i = phis.size(); i-- > 0; )
+        {
+            bytes("\x8f\x85", 2);         // pop [rbp + slot]
+            int32(slot(phis[i]));
+        }
+    }
+
+    // The condition code of a comparison; setcc is 0x90 | cc, jcc 0x80 | cc
+    // and cc ^ 1 is the negated condition.
+    static char condition(IROp op)
+    {
+        switch (op)
+        {
+            case irEQ: return 0x4;
+            case irNE: return 0x5;
+            case irLT: return 0xc;
+            case irLE: return 0xe;
+            case irGT: return 0xf;
+            default: return 0xd; // irGE
+        }
+    }
+
+    // An int result must fit in 62 bits, as Value::fromInt requires; one
+    // that does not, or that overflowed 64, leaves by the overflow exit.
+    void checkRange()
+    {
+        jump("\x0f\x80", 2, 0);         // jo overflow
+        bytes("\x48\x89\xc1", 3);      // mov rcx, rax
+        bytes("\x48\xc1\xe1\x02", 4);  // shl rcx, 2
+        bytes("\x48\xc1\xf9\x02", 4);  // sar rcx, 2
+        bytes("\x48\x39\xc1", 3);      // cmp rcx, rax
+        jump("\x0f\x85", 2, 0);         // jne overflow
+    }
+
+    void setcc(IROp op)
+    {
+        bytes("\x48\x39\xc8", 3);         // cmp rax, rcx
+        char s[3] = {'\x0f', (char) (0x90 | condition(op)), '\xc0'};
+        bytes(s, 3);                      // setcc al
+        bytes("\x0f\xb6\xc0", 3);         // movzx eax, al
+    }
+
+    // Branches to targets[0] when the jcc opcode j is not taken, else to
+    // targets[1], with the phi moves of each edge.
+    void branch(IRInstr * in, const char * j)
+    {
+        size_t skip = code.size() + 2;
+        bytes(j, 2);
+        int32(0);
+        phiMoves(in->block, in->targets[0]);
+        jump("\xe9", 1, in->targets[0]);
+        int rel = code.size() - (skip + 4);
+        memcpy(&code[skip], &rel, 4);
+        phiMoves(in->block, in->targets[1]);
+        jump("\xe9", 1, in->targets[1]);
+    }
+
+    void instr(IRInstr * in)
+    {
+        IRBlock * b = in->block;
+        switch (in->op)
+        {
+            case irParam: case irPhi:
+                return;                   // stored by the prologue and the edges
+            case irConst:
+                bytes("\x48\xb8", 2);     // mov rax, imm64
+                bytes((const char *) &in->imm, 8);
+                break;
+            case irNeg:
+                loadRax(in->args[0]);
+                bytes("\x48\xf7\xd8", 3);
+                checkRange();
+                break;
+            case irNot:                   // of an int or a bool
+                loadRax(in->args[0]);
+                bytes("\x48\x85\xc0", 3); // test rax, rax
+                bytes("\x0f\x94\xc0", 3); // sete al
+                bytes("\x0f\xb6\xc0", 3); // movzx eax, al
+                break;
+            case irBr:
+                phiMoves(b, in->targets[0]);
+                jump("\xe9", 1, in->targets[0]);
+                return;
+            case irCbr:
+                loadRax(in->args[0]);
+                bytes("\x48\x85\xc0", 3); // test rax, rax
+                branch(in, "\x0f\x84");    // je
+                return;
+            case irCmpBr:
+                loadRax(in->args[0]);
+                loadRcx(in->args[1]);
+                bytes("\x48\x39\xc8", 3); // cmp rax, rcx
+                {
+                    char j[2] = {'\x0f', (char) (0x80 | (condition(IROp(in->imm)) ^ 1))};
+                    branch(in, j);
+                }
+                return;
+            case irAddImm:
+                loadRax(in->args[0]);
+                if (in->imm == (int) in->imm)
+                {
+                    bytes("\x48\x05", 2);   // add rax, imm32
+                    int32((int) in->imm);
+                }
+                else
+                {
+                    bytes("\x48\xb9", 2);   // mov rcx, imm64; add rax, rcx
+                    bytes((const char *) &in->imm, 8);
+                    bytes("\x48\x01\xc8", 3);
+                }
+                checkRange();
+                break;
+            case irRet:
+                loadRax(in->args[0]);
+                bytes("\xc9\xc3", 2);     // leave; ret
+                return;
+            default:                      // binary
+                loadRax(in->args[0]);
+                loadRcx(in->args[1]);
+                switch (in->op)
+                {
+                    case irAdd: bytes("\x48\x01\xc8", 3); checkRange(); break;
+                    case irSub: bytes("\x48\x29\xc8", 3); checkRange(); break;
+                    case irMul: bytes("\x48\x0f\xaf\xc1", 4); checkRange(); break;
+                    default: setcc(in->op);
+                }
+        }
+        storeRax(in);
+    }
+
+    void function(IRFunction * f)
+    {
+        static const char * paramStores[] = {
+            "\x48\x89\xbd", "\x48\x89\xb5", "\x48\x89\x95",  // rdi, rsi, rdx
+            "\x48\x89\x8d", "\x4c\x89\x85", "\x4c\x89\x8d"   // rcx, r8, r9
+        };
+        bytes("\x55\x48\x89\xe5", 4);     // push rbp; mov rbp, rsp
+        bytes("\x48\x81\xec", 3);         // sub rsp, frame
+        int32((8 * f->nextValue + 15) & ~15);
+        for (size_t i = 0; i < f->params.size(); ++i)
+            load(paramStores[i], f->params[i]);
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+        {
+            labels[f->blocks[k]] = code.size();
+            for (size_t i = 0; i < f->blocks[k]->instrs.size(); ++i)
+                instr(f->blocks[k]->instrs[i]);
+        }
+        labels[0] = code.size();
+        Int overflow = JIT_OVERFLOW;
+        bytes("\x48\xb8", 2);           // mov rax, JIT_OVERFLOW
+        bytes((const char *) &overflow, 8);
+        bytes("\xc9\xc3", 2);           // leave; ret
+        for (size_t i = 0; i < fixups.size(); ++i)
+        {
+            int rel = labels[fixups[i].second] - (fixups[i].first + 4);
+            memcpy(&code[fixups[i].first], &rel, 4);
+        }
+    }
+};
+
+JitCode compileIR(IRFunction * f, bool & returnsBool)
+{
+    int kind = supported(f) ? resultKind(f) : kindMixed; // mixed: no one Value fits
+    returnsBool = kind == kindBool;
+    if (kind == kindMixed)
+    {
+        ++jitStats.rejected;
+        return 0;
+    }
+    Emitter e;
+    e.function(f);
+    size_t n = e.code.size();
+    void * p = mmap(0, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return 0;
+    memcpy(p, &e.code[0], n);
+    if (mprotect(p, n, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(p, n);
+        return 0;
+    }
+    ++jitStats.compiled;
+    jitStats.codeBytes += n;
+    return (JitCode) p;
+}
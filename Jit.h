@@ -0,0 +1,74 @@
+// *** BASELINE JIT ***
+//
+// A def whose IR uses only ints and bools (params declared int or bool,
+// constants, arithmetic, comparisons, not, phis and branches) can be
+// compiled to x86-64 by stitching a fixed template per IR operation.
+// Every SSA value lives in its own stack slot; params arrive in the SysV
+// argument registers and the result leaves in rax.  Anything else (calls,
+// globals, lists, fields, strs, None, / and %, more than six params, a
+// result that may be an int on one path and a bool on another) makes
+// compileIR return 0 and the def stays interpreted.
+//
+// Ints are checked as the executor checks them: an add, sub, mul, neg or
+// addi whose result does not fit in 62 bits returns JIT_OVERFLOW at once.
+// The code has no effects, so the caller reruns the call interpreted,
+// which traps at the right row.
+//
+// The executor (Exec.h) keeps a JitEntry per def.  It counts the calls
+// and compiles the def on the jitThreshold-th; until then, or if it
+// cannot be compiled, run() returns false and the call is interpreted.
+
+typedef Int (*JitCode)(Int, Int, Int, Int, Int, Int);
+
+#define JIT_OVERFLOW (MIN_VALUE_INT - 1) // no int result is this small
+
+JitCode compileIR(IRFunction * f, bool & returnsBool); // returnsBool: the result is a bool
+
+struct JitStats
+{
+    int compiled;
+    int rejected;
+    size_t codeBytes;
+
+    JitStats()
+        : compiled(0), rejected(0), codeBytes(0)
+    {
+    }
+
+    void put(ostream & out)
+    {
+        out << "*** JIT ***" << endl;
+        out << "compiled " << compiled << " rejected " << rejected
+            << " code " << codeBytes << " bytes" << endl;
+    }
+};
+
+extern int jitThreshold; // calls before a def is compiled (-j)
+extern JitStats jitStats;
+
+struct JitEntry
+{
+    IRFunction * ir;
+    long calls;
+    JitCode code;
+    bool returnsBool;
+
+    JitEntry(IRFunction * f)
+        : ir(f), calls(0), code(0), returnsBool(false)
+    {
+    }
+
+    // result is JIT_OVERFLOW if an int did not fit
+    bool run(const Int * args, Int & result)
+    {
+        if (!code && ++calls != jitThreshold)
+            return false;
+        if (!code && !(code = compileIR(ir, returnsBool)))
+            return false;
+        Int a[6] = {0, 0, 0, 0, 0, 0};
+        for (size_t i = 0; i < ir->params.size(); ++i)
+            a[i] = args[i];
+        result = code(a[0], a[1], a[2], a[3], a[4], a[5]);
+        return true;
+    }
+};
@@ -0,0 +1,89 @@
+#include "all.h"
+#include <csignal>
+#include <sys/time.h>
+
+Profiler & profiler()
+{
+    static Profiler p;
+    return p;
+}
+
+void takeSample(int)
+{
+    Profiler & p = profiler();
+    int depth = p.depth;
+    if (depth <= 0)
+        return;
+    if (depth > Profiler::MAX_DEPTH)
+        depth = Profiler::MAX_DEPTH;
+    int start = p.sampleStarts[p.samples];
+    if (p.samples + 1 >= Profiler::MAX_SAMPLES || start + depth > Profiler::MAX_FRAMES)
+    {
+        p.dropped = p.dropped + 1;
+        return;
+    }
+    __atomic_signal_fence(__ATOMIC_ACQUIRE);
+    for (int i = 0; i < depth; ++i)
+        p.frames[start + i] = p.stack[i];
+    p.sampleStarts[p.samples + 1] = start + depth;
+    p.samples = p.samples + 1;
+}
+
+bool Profiler :: startSampling()
+{
+    if (!frames)
+    {
+        frames = new ProfileFrame[MAX_FRAMES]; // left untouched until used
+        sampleStarts = new int[MAX_SAMPLES];
+        sampleStarts[0] = 0;
+    }
+    struct sigaction sa;
+    sa.sa_handler = takeSample;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    struct itimerval t;
+    t.it_interval.tv_sec = t.it_value.tv_sec = 0;
+    t.it_interval.tv_usec = t.it_value.tv_usec = SAMPLE_PERIOD;
+    sampling = sigaction(SIGPROF, &sa, 0) == 0 && setitimer(ITIMER_PROF, &t, 0) == 0;
+    return sampling;
+}
+
+void Profiler :: stopSampling()
+{
+    struct itimerval t = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_PROF, &t, 0);
+    signal(SIGPROF, SIG_IGN);
+    sampling = false;
+}
+
+void Profiler :: putFolded(ostream & out)
+{
+    map<string, long> stacks;
+    for (int k = 0; k < samples; ++k)
+    {
+        ostringstream line;
+        for (int i = sampleStarts[k]; i < sampleStarts[k + 1]; ++i)
+            line << (i > sampleStarts[k] ? ";" : "") << frames[i].site->name << ':' << frames[i].row;
+        ++stacks[line.str()];
+    }
+    for (map<string, long>::iterator s = stacks.begin(); s != stacks.end(); ++s)
+        out << s->first << ' ' << s->second << endl;
+    if (dropped)
+        cerr << "Profiler: " << dropped << " samples dropped, buffer full" << endl;
+}
+
+static bool moreCalls(ProfileSite * a, ProfileSite * b)
+{
+    return a->calls > b->calls || (a->calls == b->calls && a->name < b->name);
+}
+
+void Profiler :: putCalls(ostream & out)
+{
+    vector<ProfileSite *> v;
+    for (map<string, ProfileSite *>::iterator s = sites.begin(); s != sites.end(); ++s)
+        v.push_back(s->second);
+    sort(v.begin(), v.end(), moreCalls);
+    out << "*** Call Counts ***" << endl;
+    for (size_t i = 0; i < v.size(); ++i)
+        out << v[i]->calls << ' ' << v[i]->name << endl;
+}
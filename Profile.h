@@ -0,0 +1,95 @@
+// *** PROFILER ***
+//
+// The executor (Exec.h) keeps a shadow call stack: enter() when a def
+// starts running, exit() when it returns or traps, and setRow() as it
+// moves to each statement.  Sites are keyed by the def's IR name, so a
+// program loaded from the IR cache profiles the same.  With sampling on,
+// a SIGPROF timer fires every SAMPLE_PERIOD microseconds of CPU time
+// (rounded up to the kernel tick) and the handler copies the shadow
+// stack into a preallocated buffer; it never allocates or locks.  Samples
+// are written as folded stacks, one "outer:row;inner:row count" line per
+// distinct stack, the input format of flamegraph.pl and speedscope.  With
+// counting on, enter() also counts the calls of each def exactly.
+
+struct ProfileSite
+{
+    string name;  // the def's IR name: Class.method, outer.inner, __main__
+    long calls;
+
+    ProfileSite(string nm)
+        : name(nm), calls(0)
+    {
+    }
+};
+
+struct ProfileFrame
+{
+    ProfileSite * site;
+    int row;      // the statement running in this frame
+};
+
+class Profiler
+{
+    enum { MAX_DEPTH = 256, MAX_SAMPLES = 1 << 16, MAX_FRAMES = 1 << 20, SAMPLE_PERIOD = 1000 };
+
+    ProfileFrame stack[MAX_DEPTH];
+    volatile int depth;      // may exceed MAX_DEPTH; deeper frames are not kept
+    ProfileFrame * frames;   // the stacks of all samples, back to back
+    int * sampleStarts;      // sample k is frames[sampleStarts[k] .. sampleStarts[k + 1])
+    volatile int samples;
+    volatile long dropped;   // samples taken with the buffers full
+    map<string, ProfileSite *> sites;
+
+    friend void takeSample(int);
+
+public:
+    bool counting;
+    bool sampling;
+
+    Profiler()
+        : depth(0), frames(0), sampleStarts(0), samples(0), dropped(0),
+          counting(false), sampling(false)
+    {
+    }
+
+    bool enabled() const { return counting || sampling; }
+
+    ProfileSite * siteFor(string name)
+    {
+        ProfileSite *& s = sites[name];
+        if (!s)
+            s = new ProfileSite(name);
+        return s;
+    }
+
+    void enter(ProfileSite * site, int row)
+    {
+        if (counting)
+            ++site->calls;
+        if (depth < MAX_DEPTH)
+        {
+            stack[depth].site = site;
+            stack[depth].row = row;
+        }
+        __atomic_signal_fence(__ATOMIC_RELEASE); // the frame is complete before it is seen
+        depth = depth + 1;
+    }
+
+    void exit()
+    {
+        depth = depth - 1;
+    }
+
+    void setRow(int row)
+    {
+        if (depth > 0 && depth <= MAX_DEPTH)
+            stack[depth - 1].row = row;
+    }
+
+    bool startSampling();
+    void stopSampling();
+    void putFolded(ostream & out); // aggregated samples, outermost frame first
+    void putCalls(ostream & out);  // exact call counts, most called first
+};
+
+Profiler & profiler();
@@ -0,0 +1,188 @@
+// *** QUICKENING ***
+//
+// The executor (Exec.cpp) runs +, comparisons and indexing through a
+// QuickSite kept with each op.  The first run tests the operand tags the
+// slow way, then rewrites the site to the specialized form for what it
+// saw; later runs check that form with one tag test and skip the generic
+// dispatch.  A miss runs the generic op and re-quickens, and a site that
+// changes its mind more than MAX_REQUICKENS times stays generic.  Typed
+// operands quicken on their first run and never miss.
+//
+// Operands must be rooted as for any allocation (Heap.h), since a str or
+// list + allocates; quickAdd takes the rooted slots so it sees them move.
+
+enum QuickForm {quickUnseen, quickInts, quickStrs, quickIntList, quickBoolList, quickAnyList, quickGeneric};
+
+struct QuickSite
+{
+    enum { MAX_REQUICKENS = 4 };
+
+    QuickForm form;
+    int requickens;
+    long fast, slow;
+
+    QuickSite()
+        : form(quickUnseen), requickens(0), fast(0), slow(0)
+    {
+    }
+
+    void quicken(QuickForm f)
+    {
+        ++slow;
+        if (form == quickGeneric)
+            return;
+        if (form != quickUnseen && ++requickens > MAX_REQUICKENS)
+            form = quickGeneric;
+        else
+            form = f;
+    }
+};
+
+inline bool bothInts(Value a, Value b)
+{
+    return (a.bits & b.bits & 1) && !((a.bits | b.bits) & 2); // both tagged 01
+}
+
+// The form for operands a and b of + or a comparison.
+inline QuickForm operandForm(Value a, Value b)
+{
+    if (bothInts(a, b))
+        return quickInts;
+    if (isStrValue(a) && isStrValue(b))
+        return quickStrs;
+    return quickGeneric;
+}
+
+// True == 1: bools take part in arithmetic and comparisons as 0 and 1.
+inline bool isNumber(Value v)
+{
+    return v.isInt() || v.isBool();
+}
+
+inline Int numberValue(Value v)
+{
+    return v.isInt() ? v.asInt() : v.asBool();
+}
+
+// a + b for the rooted slots a and b themselves, which a list + may move.
+inline Value quickAdd(QuickSite & s, const Value & a, const Value & b)
+{
+    if (s.form == quickInts && bothInts(a, b))
+    {
+        ++s.fast;
+        // (x << 2 | 1) + (y << 2) overflows 64 bits exactly when x + y leaves 62
+        long long r;
+        if (__builtin_add_overflow((long long) a.bits, (long long) (b.bits - intTag), &r))
+            runtime_trap("int out of range");
+        return Value((unsigned long long) r);
+    }
+    if (s.form == quickStrs && isStrValue(a) && isStrValue(b))
+    {
+        ++s.fast;
+        return strConcat(a, b);
+    }
+    QuickForm f = operandForm(a, b);
+    s.quicken(f);
+    if (f == quickStrs)
+        return strConcat(a, b);
+    if (isNumber(a) && isNumber(b))
+        return Value::fromInt(numberValue(a) + numberValue(b));
+    if (isListValue(a) && isListValue(b))
+        return listConcat(a, b);
+    runtime_trap("unsupported operand types for +");
+}
+
+inline int compareStrs(Value a, Value b)
+{
+    return strString(a).compare(strString(b));
+}
+
+// op is one of irEQ .. irGE.
+inline bool compareResult(IROp op, int c)
+{
+    switch (op)
+    {
+        case irEQ: return c == 0;
+        case irNE: return c != 0;
+        case irLT: return c < 0;
+        case irLE: return c <= 0;
+        case irGT: return c > 0;
+        default: return c >= 0;
+    }
+}
+
+inline bool quickCompare(QuickSite & s, IROp op, Value a, Value b)
+{
+    if (s.form == quickInts && bothInts(a, b))
+    {
+        ++s.fast;
+        Int x = a.asInt(), y = b.asInt();
+        return compareResult(op, x < y ? -1 : x > y);
+    }
+    if (s.form == quickStrs && isStrValue(a) && isStrValue(b))
+    {
+        ++s.fast;
+        return compareResult(op, op == irEQ || op == irNE ? !strEquals(a, b) : compareStrs(a, b));
+    }
+    QuickForm f = operandForm(a, b);
+    s.quicken(f);
+    if (f == quickStrs)
+        return compareResult(op, compareStrs(a, b));
+    if (isNumber(a) && isNumber(b))
+    {
+        Int x = numberValue(a), y = numberValue(b);
+        return compareResult(op, x < y ? -1 : x > y);
+    }
+    if (op == irEQ || op == irNE) // any other pair is equal or not, but unordered
+        return compareResult(op, !valueEquals(a, b));
+    runtime_trap("unsupported operand types for a comparison");
+}
+
+// list[index] on a list or a str, with negative indices counted from the
+// end and the bounds checked on every path.
+inline Value quickGetIndex(QuickSite & s, Value list, Value index)
+{
+    if (__builtin_expect(!isNumber(index), 0))
+        runtime_trap("unsupported operand type for an index");
+    Int i = numberValue(index);
+    HeapObject * l = list.isObject() ? list.asObject() : 0;
+    switch (s.form)
+    {
+        case quickIntList:
+            if (l && l->kind == intListObj)
+            {
+                ++s.fast;
+                vector<Int> & e = static_cast<IntListObject *>(l)->elements;
+                return Value::fromInt(e[elementIndex(i, e.size())]);
+            }
+            break;
+        case quickAnyList:
+            if (l && l->kind == anyListObj)
+            {
+                ++s.fast;
+                vector<Value> & e = static_cast<AnyListObject *>(l)->elements;
+                return e[elementIndex(i, e.size())];
+            }
+            break;
+        case quickBoolList:
+            if (l && l->kind == boolListObj)
+            {
+                ++s.fast;
+                BoolListObject * bl = static_cast<BoolListObject *>(l);
+                return Value::fromBool(bl->at(elementIndex(i, bl->size)));
+            }
+            break;
+        default:
+            break;
+    }
+    if (isListValue(list))
+    {
+        s.quicken(l->kind == intListObj ? quickIntList
+                  : l->kind == boolListObj ? quickBoolList : quickAnyList);
+        return listGet(l, i);
+    }
+    s.quicken(quickGeneric);
+    if (isStrValue(list))
+        return strGet(list, i);
+    runtime_trap("index into a value that is neither a list nor a str");
+}
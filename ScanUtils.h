@@ -0,0 +1,276 @@
+// *** SCANNING HELPERS ***
+//
+// Hand-written fast paths for the scanner: the spans of blanks, identifier
+// characters and digits are found 16 (SSE2) or 32 (AVX2) bytes at a time,
+// falling back to a byte loop for the tail and on other targets.  Each
+// function returns the first position at or after p that is NOT in the
+// class, never reading at or past end.
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+enum CharClass {isBlank, isDigit, isIdentChar};
+
+inline bool inCharClass(char c, CharClass cls)
+{
+    switch (cls)
+    {
+        case isBlank: return c == ' ' || c == '\t';
+        case isDigit: return c >= '0' && c <= '9';
+        case isIdentChar:
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+                || (c >= '0' && c <= '9') || c == '_';
+    }
+    return false;
+}
+
+#if defined(__SSE2__)
+
+// lo <= c <= hi, bytes >= 0x80 compare as negative and so never match
+inline __m128i inRange16(__m128i v, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+inline unsigned classMask16(const char * p, CharClass cls)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    __m128i m;
+    switch (cls)
+    {
+        case isBlank:
+            m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+            break;
+        case isDigit:
+            m = inRange16(v, '0', '9');
+            break;
+        default:
+            m = _mm_or_si128(_mm_or_si128(inRange16(v, 'a', 'z'), inRange16(v, 'A', 'Z')),
+                             _mm_or_si128(inRange16(v, '0', '9'),
+                                          _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))));
+    }
+    return (unsigned) _mm_movemask_epi8(m);
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+inline __m256i inRange32(__m256i v, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+inline unsigned classMask32(const char * p, CharClass cls)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *) p);
+    __m256i m;
+    switch (cls)
+    {
+        case isBlank:
+            m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+            break;
+        case isDigit:
+            m = inRange32(v, '0', '9');
+            break;
+        default:
+            m = _mm256_or_si256(_mm256_or_si256(inRange32(v, 'a', 'z'), inRange32(v, 'A', 'Z')),
+                                _mm256_or_si256(inRange32(v, '0', '9'),
+                                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'))));
+    }
+    return (unsigned) _mm256_movemask_epi8(m);
+}
+
+#endif
+
+inline const char * spanCharClass(const char * p, const char * end, CharClass cls)
+{
+#if defined(__AVX2__)
+    for (; end - p >= 32; p += 32)
+    {
+        unsigned m = ~classMask32(p, cls);
+        if (m)
+            return p + __builtin_ctz(m);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; end - p >= 16; p += 16)
+    {
+        unsigned m = ~classMask16(p, cls) & 0xFFFF;
+        if (m)
+            return p + __builtin_ctz(m);
+    }
+#endif
+    while (p < end && inCharClass(*p, cls))
+        ++p;
+    return p;
+}
+
+inline const char * skipBlanks(const char * p, const char * end)
+{
+    return spanCharClass(p, end, isBlank);
+}
+
+inline const char * scanIdentifier(const char * p, const char * end)
+{
+    return spanCharClass(p, end, isIdentChar);
+}
+
+inline const char * scanDigits(const char * p, const char * end)
+{
+    return spanCharClass(p, end, isDigit);
+}
+
+#define TAB_WIDTH 8
+
+// Column of the first non-blank character of the line starting at p, with
+// tabs advancing to the next multiple of TAB_WIDTH; *after is set to it.
+
+inline int countIndent(const char * p, const char * end, const char ** after)
+{
+    int col = 0;
+    const char * q = skipBlanks(p, end);
+    for (; p < q; ++p)
+        col = *p == '\t' ? (col / TAB_WIDTH + 1) * TAB_WIDTH : col + 1;
+    *after = q;
+    return col;
+}
+
+// The stack of open indentation columns.  indent() compares a new logical
+// line's column against it and returns 1 for an Indent, -n for n Dedents,
+// 0 for neither; a column matching no open level is reported through ok.
+
+struct IndentStack
+{
+    intList cols;
+
+    IndentStack()
+        : cols(new intPair(0, 0))
+    {
+    }
+
+    int depth()
+    {
+        int d = 0;
+        for (intList p = cols; p->next; p = p->next)
+            ++d;
+        return d;
+    }
+
+    int indent(int col, bool & ok)
+    {
+        ok = true;
+        if (col > cols->info)
+        {
+            cols = new intPair(col, cols);
+            return 1;
+        }
+        int n = 0;
+        while (col < cols->info)
+        {
+            cols = cols->next;
+            --n;
+        }
+        ok = col == cols->info;
+        return n;
+    }
+
+    int closeAll() // Dedents owed at end of input
+    {
+        int n = depth();
+        while (cols->next)
+            cols = cols->next;
+        return -n;
+    }
+};
+
+// *** PARALLEL SCANNING ***
+//
+// A line that starts in column 0 with a token (not blank, not a comment),
+// outside any string or bracket, resets the IndentStack to its base: the
+// Dedents it causes are exactly closeAll() of the state before it.  Such
+// lines split the input into chunks that can be tokenized independently,
+// each from a fresh IndentStack, provided every chunk but the last ends
+// with closeAll() Dedents and only the last emits EndMarker.  A line
+// ended by a backslash continues onto the next, so the next is never a
+// split point.  scanInParallel runs std::thread workers: link with
+// -pthread.
+
+inline bool startsLogicalLine(const char * p, const char * end)
+{
+    return p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' && *p != '#';
+}
+
+// Offsets of up to parts-1 split points, each the start of such a line at
+// or after the next multiple of n/parts; the result begins with 0 and ends
+// with n.  Quotes and brackets are tracked from the start of the buffer.
+
+inline vector<size_t> splitAtLogicalLines(const char * buf, size_t n, int parts)
+{
+    vector<size_t> cuts(1, 0);
+    size_t want = parts > 1 ? n / parts : n;
+    int brackets = 0;
+    char quote = 0;
+    for (size_t i = 0; i < n && cuts.size() < (size_t) parts; ++i)
+    {
+        char c = buf[i];
+        if (quote)
+        {
+            if (c == '\\')
+                ++i;
+            else if (c == quote || c == '\n')
+                quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+            quote = c;
+        else if (c == '#')
+            while (i + 1 < n && buf[i + 1] != '\n')
+                ++i;
+        else if (c == '\\') // line continuation: skip the newline it escapes
+        {
+            if (i + 1 < n && buf[i + 1] == '\r')
+                ++i;
+            if (i + 1 < n && buf[i + 1] == '\n')
+                ++i;
+        }
+        else if (c == '(' || c == '[' || c == '{')
+            ++brackets;
+        else if ((c == ')' || c == ']' || c == '}') && brackets > 0)
+            --brackets;
+        else if (c == '\n' && !brackets && i + 1 >= cuts.size() * want
+                 && startsLogicalLine(buf + i + 1, buf + n))
+            cuts.push_back(i + 1);
+    }
+    cuts.push_back(n);
+    return cuts;
+}
+
+// Runs scanChunk(begin, end, isLast, out) over the chunks on separate
+// threads and concatenates their outputs in source order.  T is whatever
+// the chunk scanner records per token.
+
+template <typename T, typename ChunkScanner>
+vector<T> scanInParallel(const char * buf, size_t n, int parts, ChunkScanner scanChunk)
+{
+    vector<size_t> cuts = splitAtLogicalLines(buf, n, parts);
+    size_t chunks = cuts.size() - 1;
+    vector< vector<T> > outs(chunks);
+    vector<thread> workers;
+    for (size_t k = 0; k < chunks; ++k)
+        workers.push_back(thread(scanChunk, buf + cuts[k], buf + cuts[k + 1],
+                                 k + 1 == chunks, ref(outs[k])));
+    for (size_t k = 0; k < chunks; ++k)
+        workers[k].join();
+    vector<T> all;
+    for (size_t k = 0; k < chunks; ++k)
+        all.insert(all.end(), outs[k].begin(), outs[k].end());
+    return all;
+}
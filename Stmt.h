@@ -7,8 +7,44 @@ typedef StmtPair * StmtList;
 
 struct StmtBlock
 {
+    int row;    // the first source line the statement was built from
+
     StmtBlock()
+        : row(::row)
+    {
+        nodeArena().own(this, destroy);
+    }
+
+    virtual ~StmtBlock()
+    {
+    }
+
+    static void destroy(void * node)
+    {
+        static_cast<StmtBlock *>(node)->~StmtBlock();
+    }
+
+    // As ExprBlock::startAt: a compound statement starts at its first part.
+    void startAt(Expr e)
+    {
+        if (e && !e->isConst() && e->row < row)
+            row = e->row;
+    }
+
+    void startAt(Stmt s)
+    {
+        if (s && s->row < row)
+            row = s->row;
+    }
+
+    static void * operator new(size_t n)
+    {
+        return nodeArena().allocate(n);
+    }
+
+    static void operator delete(void * p)
     {
+        // the storage goes back with the arena's blocks (Arena.h)
     }
 
     virtual void put(ostream & out)
@@ -84,6 +120,8 @@ struct IfStmt
     IfStmt(Expr c, Stmt t, Stmt f = 0)
         : StmtBlock(), cond(c), trueStmt(t), falseStmt(f)
     {
+        startAt(c);
+        startAt(t);
     }
 
     static Stmt make(Expr c, Stmt t, Stmt f)
@@ -111,6 +149,8 @@ struct ForStmt
     ForStmt(string i, Expr e, Stmt s)
         : StmtBlock(), ident(i), ex(e), stmt(s)
     {
+        startAt(e);
+        startAt(s);
     }
 
     static Stmt make(string i, Expr e, Stmt s)
@@ -136,6 +176,8 @@ struct WhileStmt
     WhileStmt(Expr c, Stmt s)
         : StmtBlock(), cond(c), stmt(s)
     {
+        startAt(c);
+        startAt(s);
     }
 
     static Stmt make(Expr c, Stmt s)
@@ -159,6 +201,7 @@ struct ReturnStmt
     ReturnStmt(Expr e)
         : StmtBlock(), expr(e)
     {
+        startAt(e);
     }
 
     static Stmt make(Expr e)
@@ -184,6 +227,8 @@ struct BlockStmt
     BlockStmt(StmtList sl)
         : StmtBlock(), stmts(sl)
     {
+        if (sl)
+            startAt(sl->info);
     }
 
     static Stmt make(StmtList sl)
@@ -208,6 +253,7 @@ struct CallStmt
     CallStmt(Expr o)
         : StmtBlock(), object(o)
     {
+        startAt(o);
     }
 
     static Stmt make(Expr o)
@@ -230,6 +276,7 @@ struct AssignStmt
     AssignStmt(Expr o)
         : StmtBlock(), object(o)
     {
+        startAt(o);
     }
 
     static Stmt make(Expr o)
@@ -322,6 +369,7 @@ struct VarStmt
     VarStmt(string nm, Type ty, Expr i)
         : StmtBlock(), name(nm), type(ty), init(i)
     {
+        startAt(i);
     }
 
     static Stmt make(string nm, Type ty, Expr i)
@@ -380,6 +428,9 @@ struct DefStmt
     DefStmt(string nm, StmtList prms, Type rt, Stmt bdy)
         : StmtBlock(), name(nm), params(prms), ret_type(rt), body(bdy)
     {
+        if (prms)
+            startAt(prms->info);
+        startAt(bdy);
     }
 
     static Stmt make(string nm, StmtList prms, Type rt, Stmt bdy)
@@ -414,6 +465,7 @@ struct ClassStmt
     ClassStmt(string nm, TypeList bc, Stmt bdy)
         : StmtBlock(), name(nm), bases(bc), body(bdy)
     {
+        startAt(bdy);
     }
 
     static Stmt make(string nm, TypeList bc, Stmt bdy)
@@ -0,0 +1,107 @@
+#include "all.h"
+
+// *** SUPERINSTRUCTIONS ***
+//
+// countOpcodePairs profiles a program for instructions whose value feeds
+// the very next one (-i prints the most frequent).  In our programs a
+// comparison into the cbr of an if or while (a < b) leads, and a str
+// constant into print is common.  Constants are shared by CSE and rarely
+// sit next to their use, so an add or sub with a constant operand
+// (i = i + 1) is fused wherever it is.  fuseSuperinstructions turns each
+// of these into a single op, so an engine dispatches once for both and
+// the JIT emits cmp + jcc instead of setcc, test and jcc.
+
+SuperStats superStats;
+
+static bool byCount(const pair<string, long> & a, const pair<string, long> & b)
+{
+    return a.second > b.second || (a.second == b.second && a.first < b.first);
+}
+
+void SuperStats :: put(ostream & out)
+{
+    vector<pair<string, long> > v(pairs.begin(), pairs.end());
+    sort(v.begin(), v.end(), byCount);
+    out << "*** Opcode Pairs ***" << endl;
+    for (size_t i = 0; i < v.size() && i < 10; ++i)
+        out << v[i].second << ' ' << v[i].first << endl;
+    out << "fused addi " << addImm << " cmpbr " << cmpBr << " printstr " << printStr << endl;
+}
+
+void countOpcodePairs(IRModule * m)
+{
+    for (size_t i = 0; i < m->functions.size(); ++i)
+    {
+        IRFunction * f = m->functions[i];
+        for (size_t k = 0; k < f->blocks.size(); ++k)
+        {
+            vector<IRInstr *> & in = f->blocks[k]->instrs;
+            for (size_t j = 1; j < in.size(); ++j)
+                if (find(in[j]->args.begin(), in[j]->args.end(), in[j - 1]) != in[j]->args.end())
+                    ++superStats.pairs[string(opName(in[j - 1]->op)) + " " + opName(in[j]->op)];
+        }
+    }
+}
+
+static bool isComparison(IROp op)
+{
+    return op == irEQ || op == irNE || op == irLT || op == irLE || op == irGT || op == irGE;
+}
+
+void fuseSuperinstructions(IRFunction * f)
+{
+    map<IRInstr *, int> uses;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        for (size_t i = 0; i < f->blocks[k]->instrs.size(); ++i)
+        {
+            IRInstr * in = f->blocks[k]->instrs[i];
+            for (size_t j = 0; j < in->args.size(); ++j)
+                ++uses[in->args[j]];
+        }
+
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+    {
+        vector<IRInstr *> & in = f->blocks[k]->instrs;
+        for (size_t i = 0; i < in.size(); ++i)
+        {
+            IRInstr * s = in[i];
+            if ((s->op == irAdd || s->op == irSub) && s->args[1]->op == irConst)
+            {
+                s->imm = s->op == irAdd ? s->args[1]->imm : -s->args[1]->imm;
+                s->op = irAddImm;
+                --uses[s->args[1]];
+                s->args.resize(1);
+                ++superStats.addImm;
+            }
+            else if (s->op == irAdd && s->args[0]->op == irConst)
+            {
+                s->imm = s->args[0]->imm;
+                s->op = irAddImm;
+                --uses[s->args[0]];
+                s->args.erase(s->args.begin());
+                ++superStats.addImm;
+            }
+            else if (s->op == irCbr && i > 0 && in[i - 1] == s->args[0]
+                     && isComparison(s->args[0]->op) && uses[s->args[0]] == 1)
+            {
+                IRInstr * cmp = s->args[0];
+                s->op = irCmpBr;
+                s->imm = cmp->op;
+                s->name = opName(cmp->op);
+                s->args = cmp->args;
+                in.erase(in.begin() + --i);
+                ++superStats.cmpBr;
+            }
+            else if (s->op == irPrint && s->args.size() == 1 && s->args[0]->op == irStr
+                     && uses[s->args[0]] == 1)
+            {
+                s->op = irPrintStr;
+                s->name = s->args[0]->name;
+                --uses[s->args[0]];
+                s->args.clear();
+                ++superStats.printStr;
+            }
+        }
+    }
+    eliminateDeadCode(f); // the constants that were folded in
+}
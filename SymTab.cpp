@@ -5,31 +5,78 @@ SymTab ST;
 void SymTab :: enterSymbol(Symbol sy)
 {
     head->info = new SymbolPair(sy, head->info);
+    filters->info.add(ScopeFilter::keyFor(sy->name));
+    forget(sy->name); // may now shadow a cached resolution
+}
+
+Symbol SymTab :: findSymbolInScope(const ScopeFilter::Key & k, string name,
+                                   SymbolListList sll, ScopeFilterList fl)
+{
+    if (!fl->info.mayContain(k))
+    {
+        ++stats.scopesSkipped;
+        return 0;
+    }
+    ++stats.scopesScanned;
+    Symbol sy = findSymbolInList(name, sll->info);
+    if (!sy)
+        ++stats.falsePositives;
+    return sy;
 }
 
 Symbol SymTab :: findSymbolInTopScope(string name)
 {
-    return findSymbolInList(name, head->info);
+    ++stats.lookups;
+    Symbol sy = findSymbolInScope(ScopeFilter::keyFor(name), name, head, filters);
+    ++(sy ? stats.hits : stats.misses);
+    return sy;
 }
 
-void SymTab :: enterScope(string name, SymbolList syli)
+// A scope with an owner is that def's body.  A function body gets its own
+// frame, with the params in syli taking slots 0..n-1 and locals following;
+// a class body declares attributes, which take no slot until the class's
+// layout is built (ClassType::buildMethodTable).  Any other scope is a
+// block in the enclosing frame.
+
+void SymTab :: enterScope(string name, SymbolList syli, Symbol owner)
 {
+    trace(traceScopes, "enter scope " << name);
     names = new stringPair(name, names);
     head = new SymbolListPair(syli, head);
+    filters = new ScopeFilterPair(ScopeFilter(), filters);
+    owners = new SymbolPair(owner, owners);
+    if (dynamic_cast<FuncSymbol *>(owner))
+        enterFrame();
+    for (SymbolList p = syli; p; p = p->next)
+    {
+        filters->info.add(ScopeFilter::keyFor(p->info->name));
+        forget(p->info->name);
+        if (p->info->needsSlot())
+            allocateSlot(p->info);
+    }
 }
 
 SymbolList SymTab :: exitScope()
 {
     SymbolList t = head->info;
-    head = head->next;
+    for (SymbolList p = t; p; p = p->next)
+        forget(p->info->name);
+    popPair(head);
+    popPair(filters);
+    if (FuncSymbol * fn = dynamic_cast<FuncSymbol *>(owners->info))
+        fn->frameSize = exitFrame();
+    popPair(owners);
     string name = names->info;
+    trace(traceScopes, "exit scope " << name);
+    if (exited)
+        exited->push_back(make_pair(name, t));
     if (HW == 4 || HW == 5)
     {
         cout << "*** Exit Scope " << name << " ***" << endl;
         putSymbolList(cout, t);
         cout << endl;
     }
-    names = names->next;
+    popPair(names);
     return t;
 }
 
@@ -43,20 +90,51 @@ Symbol SymTab :: findSymbolInList(string name, SymbolList sl)
 
 Symbol SymTab :: findSymbol(string name)
 {
-    for (SymbolListList sll = head; sll; sll = sll->next)
-        if (Symbol sy = findSymbolInList(name, sll->info))
+    ++stats.lookups;
+    ScopeFilter::Key k = ScopeFilter::keyFor(name);
+    ScopeFilterList fl = filters;
+    for (SymbolListList sll = head; sll; sll = sll->next, fl = fl->next)
+        if (Symbol sy = findSymbolInScope(k, name, sll, fl))
+        {
+            ++stats.hits;
+            trace(traceLookups, "found " << name);
             return sy;
+        }
+    ++stats.misses;
+    trace(traceLookups, "not found " << name);
     return 0;
 }
 
+// Type annotations name the same few classes over and over; a cached
+// resolution stays valid until a declaration of that name enters or
+// leaves scope, both of which forget() it.
+
+Symbol SymTab :: findTypeSymbol(string name)
+{
+    SymbolCache::iterator it = typeCache.find(name);
+    if (it != typeCache.end())
+    {
+        ++stats.typeCacheHits;
+        return it->second;
+    }
+    Symbol sy = findSymbol(name);
+    if (sy)
+        typeCache[name] = sy;
+    return sy;
+}
+
 void SymTab :: declare(Symbol sy)
 {
     Symbol oldSy = findSymbolInTopScope(sy->name);
     if (oldSy)
         semantic_error("multiple definitions in scope");
     else
+    {
         enterSymbol(sy);
-    debug("declaring symbol " + sy->name);
+        if (sy->needsSlot())
+            allocateSlot(sy);
+    }
+    trace(traceScopes, "declaring symbol " << sy->name);
 }
 
 void SymTab :: putSymbolList(ostream & out, SymbolList L)
@@ -68,6 +146,45 @@ void SymTab :: putSymbolList(ostream & out, SymbolList L)
         }
 }
 
+void SymTab :: allocateSlot(Symbol sy)
+{
+    if (dynamic_cast<ClassSymbol *>(owners->info))
+        return; // an attribute: its offset is per class
+    sy->depth = frameDepth;
+    sy->slot = frames->info++;
+}
+
+void SymTab :: enterFrame()
+{
+    frames = new intPair(0, frames);
+    ++frameDepth;
+}
+
+int SymTab :: exitFrame()
+{
+    int size = frames->info;
+    popPair(frames);
+    --frameDepth;
+    return size;
+}
+
+int SymTab :: globalFrameSize()
+{
+    intList p = frames;
+    while (p->next)
+        p = p->next;
+    return p->info;
+}
+
+void SymTabStats :: put(ostream & out)
+{
+    out << "*** Symbol Table Lookups ***" << endl;
+    out << "lookups " << lookups << " hits " << hits << " misses " << misses << endl;
+    out << "scopes scanned " << scopesScanned << " skipped " << scopesSkipped
+        << " false positives " << falsePositives << endl;
+    out << "type names resolved from the cache " << typeCacheHits << endl;
+}
+
 void SymTab :: put(ostream & out)
 {
     for (SymbolListList sll = head; sll; sll = sll->next)
@@ -3,35 +3,165 @@
 #define popSymbolListList(l) (l) = (l)->next
 #define topSymbolListList(l) (l)->info
 
+// Compact summary of the names declared in one scope.  A name hashes to
+// three bits; a scope whose filter lacks any of them cannot contain the
+// name, so findSymbol skips it without scanning its SymbolList.
+
+struct ScopeFilter
+{
+    enum { WORDS = 4, BITS = WORDS * 64 };
+    unsigned long long bits[WORDS];
+
+    struct Key
+    {
+        unsigned short bit[3];
+    };
+
+    ScopeFilter()
+    {
+        for (int i = 0; i < WORDS; ++i)
+            bits[i] = 0;
+    }
+
+    static Key keyFor(const string & name)
+    {
+        unsigned long long h = 14695981039346656037ULL; // FNV-1a
+        for (size_t i = 0; i < name.size(); ++i)
+        {
+            h ^= (unsigned char) name[i];
+            h *= 1099511628211ULL;
+        }
+        Key k;
+        for (int i = 0; i < 3; ++i, h >>= 16)
+            k.bit[i] = h % BITS;
+        return k;
+    }
+
+    void add(const Key & k)
+    {
+        for (int i = 0; i < 3; ++i)
+            bits[k.bit[i] / 64] |= 1ULL << (k.bit[i] % 64);
+    }
+
+    bool mayContain(const Key & k) const
+    {
+        for (int i = 0; i < 3; ++i)
+            if (!(bits[k.bit[i] / 64] & (1ULL << (k.bit[i] % 64))))
+                return false;
+        return true;
+    }
+};
+
+typedef ListPair<ScopeFilter> ScopeFilterPair;
+typedef ScopeFilterPair * ScopeFilterList;
+
+struct SymTabStats
+{
+    long lookups;       // calls to findSymbol / findSymbolInTopScope
+    long hits;          // lookups that found a symbol
+    long misses;        // lookups that found nothing
+    long scopesScanned; // SymbolLists actually walked
+    long scopesSkipped; // SymbolLists ruled out by their filter
+    long falsePositives; // scanned because of the filter, but name absent
+    long typeCacheHits; // findTypeSymbol calls answered without a lookup
+
+    SymTabStats()
+        : lookups(0), hits(0), misses(0),
+          scopesScanned(0), scopesSkipped(0), falsePositives(0), typeCacheHits(0)
+    {
+    }
+
+    void put(ostream & out);
+};
+
+// Unlinks and frees the first pair of a list the symbol table owns; what
+// the pair holds is left alone.
+template <class T>
+void popPair(ListPair<T> *& l)
+{
+    ListPair<T> * top = l;
+    l = l->next;
+    top->next = 0;
+    delete top;
+}
+
+typedef map<string, Symbol> SymbolCache;
+
 class SymTab
 {
     SymbolListList head;
     stringList names;
+    ScopeFilterList filters; // parallel to head, one filter per scope
+    SymTabStats stats;
+    SymbolList owners; // parallel to head: the FuncSymbol or ClassSymbol of a scope, else 0
+    intList frames; // slots used so far in each open frame, innermost first
+    int frameDepth; // open frames minus one, 0 while only globals are open
+    SymbolCache typeCache; // names resolved by findTypeSymbol
+    vector<Symbol> builtins; // the builtin type names, kept across reset()
+    void forget(string name) { typeCache.erase(name); }
+    void allocateSlot(Symbol sy);
+    Symbol findSymbolInScope(const ScopeFilter::Key & k, string name,
+                             SymbolListList sll, ScopeFilterList fl);
 protected:
     void enterSymbol(Symbol sy); // puts symbol in top scope
     Symbol findSymbolInTopScope(string name); // looks only in top scope
 public:
+    vector<pair<string, SymbolList> > * exited; // if set, exitScope records each scope here
+
     SymTab()
+        : head(0), names(0), filters(0), owners(0), frames(0), exited(0)
     {
-        head = 0;
-        names = 0; // for debugging, save name of each scope
+        const char * builtinNames[] = {"void", "str", "int", "bool", "any"};
+        Type types[] = {VoidType::make(), StrType::make(), IntType::make(), BoolType::make(), AnyType::make()};
+        for (int i = 0; i < 5; ++i)
+        {
+            Symbol sy = ::new TypeSymbol(builtinNames[i], types[i]);
+            nodeArena().disown(sy); // outlives every mark, as the types do
+            builtins.push_back(sy);
+        }
+        reset();
+    }
+
+    // Back to just the builtin types, as before any check.  The scope
+    // chains of the last check are freed; the symbols they held go when
+    // checkSource releases its arena mark.
+    void reset()
+    {
+        while (head)
+            popPair(head);
+        while (names) // for debugging, save name of each scope
+            popPair(names);
+        while (filters)
+            popPair(filters);
+        while (owners)
+            popPair(owners);
+        while (frames)
+            popPair(frames);
+        frames = new intPair(0, 0); // the global frame
+        frameDepth = 0;
+        typeCache.clear();
         enterScope("TOP LEVEL");
-        enterSymbol(TypeSymbol::make("void", VoidType :: make()));
-        enterSymbol(TypeSymbol::make("str", StrType :: make()));
-        enterSymbol(TypeSymbol::make("int", IntType :: make()));
-        enterSymbol(TypeSymbol::make("bool", BoolType :: make()));
-        enterSymbol(TypeSymbol::make("any", AnyType :: make()));
+        for (size_t i = 0; i < builtins.size(); ++i)
+            enterSymbol(builtins[i]);
     }
+
     ~SymTab()
     {
         if (head) exitScope();
     }
-    void enterScope(string name, SymbolList syli = 0); // enters syli into new top scope
+    void enterScope(string name, SymbolList syli = 0, Symbol owner = 0);
+                                   // enters syli into new top scope; owner is the
+                                   // FuncSymbol or ClassSymbol whose body it is
     SymbolList exitScope(); // returns symbols removed from top scope
     SymbolListList topScope() { return head; }
     Symbol findSymbol(string name); // returns visible declaration for name
+    Symbol findTypeSymbol(string name); // findSymbol, cached for type names
     void declare(Symbol sy); // handles object declarations with checking
+    void enterFrame(); // slots declared from now on go in a new frame
+    int exitFrame(); // returns the number of slots the frame used
+    int globalFrameSize();
     static Symbol findSymbolInList(string name, SymbolList sl);
+    SymTabStats & getStats() { return stats; }
 
     static void putSymbolList(ostream &out, SymbolList L);
     void put(ostream & out); // print out a symbol table for debugging
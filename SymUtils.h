@@ -3,7 +3,14 @@ SymbolList exitScope();
 void declare(Symbol sy);
 
 void enterClass(string name, TypeList parents);
-void exitClass(string name);
+void exitClass(string name); // builds the ClassType's method table
+
+// enterFunc declares the FuncSymbol and then enters a scope of the same
+// name with the params, passing the FuncSymbol as the scope's owner (as
+// enterClass passes its ClassSymbol); ST gives that scope its own frame, so the params
+// take slots 0..n-1 and locals follow, and stores the frame's size in the
+// FuncSymbol's frameSize when the scope exits.  Class attributes get their
+// offsets from exitClass.  Top-level variables take global slots.
 
 void enterFunc(Symbol fn, SymbolList params);
 void declareFuncReturnType(Type ty);
@@ -16,7 +23,7 @@ void declareLoopVar(string name, Expr ex);
 
 Symbol findIdentExpr(string name);
 Symbol findIdentInClassType(string name, Type cs);
-Type findIdentType(string name);
+Type findIdentType(string name); // resolves through ST.findTypeSymbol
 Type findListElementType(Type ty);
 Type findFuncReturnTypeInType(Type ty);
 Type findExprTypeOfFirstInList(ExprList L);
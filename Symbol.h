@@ -33,6 +33,34 @@ struct TypeBlock
     TypeBlock(string nm)
         : type(0), name(nm)
     {
+        nodeArena().own(this, destroy);
+    }
+
+    virtual ~TypeBlock()
+    {
+    }
+
+    static void destroy(void * node)
+    {
+        static_cast<TypeBlock *>(node)->~TypeBlock();
+    }
+
+    static void * operator new(size_t n)
+    {
+        return nodeArena().allocate(n);
+    }
+
+    static void operator delete(void * p)
+    {
+        // the storage goes back with the arena's blocks (Arena.h)
+    }
+
+    // The builtin types are singletons shared by every check: they come
+    // from the global heap and are never released.
+    static Type builtin(TypeBlock * t)
+    {
+        nodeArena().disown(t);
+        return t;
     }
 
     virtual void put(ostream & out)
@@ -68,7 +96,7 @@ struct TypeBlock
     {
         Type t1 = rootType(this);
         Type t2 = rootType(ty);
-        if (DEBUG) cout << "2) isSameType: T1 = " << t1->name << " T2 = " << t2->name << endl;
+        trace(traceTypes, "isSameType: T1 = " << t1->name << " T2 = " << t2->name);
         if ( t1 == t2 )
             return true;
         if ( t1->behavior(isAny) || t2->behavior(isAny) )
@@ -137,7 +165,14 @@ struct IdentType
             out << name;
     }
 
-    virtual void check();
+    virtual void check(); // binds through ST.findTypeSymbol
+
+    // Point directly at the root TypeBlock of the resolved type, so
+    // behavior() and isSameType() never walk a chain of IdentTypes.
+    void bind(Type ty)
+    {
+        type = ty ? rootType(ty) : 0;
+    }
 
     virtual bool behavior(TypeBehavior b)
     {
@@ -160,8 +195,7 @@ struct BoolType
 
     static Type make()
     {
-        static Type t = 0;
-        if (!t) t = new BoolType();
+        static Type t = builtin(::new BoolType());
         return t;
     }
 
@@ -186,8 +220,7 @@ struct IntType
 
     static Type make()
     {
-        static Type t = 0;
-        if (!t) t = new IntType();
+        static Type t = builtin(::new IntType());
         return t;
     }
 
@@ -213,8 +246,7 @@ struct StrType
 
     static Type make()
     {
-        static Type t = 0;
-        if (!t) t = new StrType();
+        static Type t = builtin(::new StrType());
         return t;
     }
 
@@ -240,8 +272,7 @@ struct VoidType
 
     static Type make()
     {
-        static Type t = 0;
-        if (!t) t = new VoidType();
+        static Type t = builtin(::new VoidType());
         return t;
     }
 
@@ -266,8 +297,7 @@ struct AnyType
 
     static Type make()
     {
-        static Type t = 0;
-        if (!t) t = new AnyType();
+        static Type t = builtin(::new AnyType());
         return t;
     }
 
@@ -380,9 +410,13 @@ struct ClassType
 {
     SymbolList members;
     SymbolListList scopeHolder;
+    vector<Symbol> methods; // method table, built by exitClass
+    vector<Symbol> fields;  // attribute at each object offset, built with it
+    vector<ClassType *> baseClasses; // direct, in order, recorded with it
+    bool unstableIndices;   // a subclass placed its methods elsewhere
 
     ClassType(SymbolList m)
-        : TypeBlock("Class"), members(m)
+        : TypeBlock("Class"), members(m), scopeHolder(0), unstableIndices(false)
     {
     }
 
@@ -410,6 +444,11 @@ struct ClassType
     {
         return findSymbolInList(name, scopeHolder->info);
     }
+
+    int methodIndex(const string & name); // -1 if not a method
+    int fieldIndex(const string & name);  // -1 if not an attribute
+    void markUnstable();                  // this class and all its ancestors
+    void buildMethodTable(TypeList bases); // and the field layout
 };
 
 struct UndefinedType
@@ -447,10 +486,37 @@ struct SymbolBlock
 {
     string name;
     Type type;
+    int depth; // frame nesting of its storage, 0 = globals, -1 for attributes
+    int slot;  // index in that frame or offset in the object, -1 if it has no storage
 
     SymbolBlock(string nm, Type ty)
-        : name(nm), type(ty)
+        : name(nm), type(ty), depth(-1), slot(-1)
+    {
+        nodeArena().own(this, destroy);
+    }
+
+    virtual ~SymbolBlock()
+    {
+    }
+
+    static void destroy(void * node)
+    {
+        static_cast<SymbolBlock *>(node)->~SymbolBlock();
+    }
+
+    static void * operator new(size_t n)
+    {
+        return nodeArena().allocate(n);
+    }
+
+    static void operator delete(void * p)
+    {
+        // the storage goes back with the arena's blocks (Arena.h)
+    }
+
+    virtual bool needsSlot() // variables and parameters occupy a frame slot
     {
+        return false;
     }
 
     virtual void put(ostream & out)
@@ -510,6 +576,11 @@ struct VarSymbol
         return new VarSymbol(n, rt);
     }
 
+    virtual bool needsSlot()
+    {
+        return true;
+    }
+
 
 };
 
@@ -527,6 +598,11 @@ struct ParamSymbol
         return new ParamSymbol(n, rt);
     }
 
+    virtual bool needsSlot()
+    {
+        return true;
+    }
+
 
 };
 
@@ -570,9 +646,10 @@ struct FuncSymbol
     : SymbolBlock
 {
     SymbolList params;
+    int frameSize; // slots for params and locals, set when its scope exits
 
     FuncSymbol(string n, SymbolList prms, Type rt)
-        : SymbolBlock(n, rt), params(prms)
+        : SymbolBlock(n, rt), params(prms), frameSize(0)
     {
         rt->name = n;
     }
@@ -585,6 +662,109 @@ struct FuncSymbol
 
 };
 
+inline int ClassType :: methodIndex(const string & name)
+{
+    for (size_t i = 0; i < methods.size(); ++i)
+        if (methods[i]->name == name)
+            return i;
+    return -1;
+}
+
+// An object of a subclass can be used as any of its ancestors, so a
+// method moved away from one's index is moved away from theirs as well.
+inline void ClassType :: markUnstable()
+{
+    if (unstableIndices)
+        return; // and so are its ancestors already
+    unstableIndices = true;
+    for (size_t i = 0; i < baseClasses.size(); ++i)
+        baseClasses[i]->markUnstable();
+}
+
+inline int ClassType :: fieldIndex(const string & name)
+{
+    for (size_t i = 0; i < fields.size(); ++i)
+        if (fields[i]->name == name)
+            return i;
+    return -1;
+}
+
+// The first base's table is copied unchanged, so along first bases a
+// method keeps its index in every subclass; methods of later bases that
+// are not already present follow, and then this class's own methods,
+// each either overriding an inherited slot or appended.
+
+inline void ClassType :: buildMethodTable(TypeList bases)
+{
+    methods.clear();
+    baseClasses.clear();
+    bool first = true;
+    for (TypeList b = bases; b; b = b->next)
+    {
+        ClassType * base = dynamic_cast<ClassType *>(rootType(b->info));
+        if (!base)
+            continue;
+        baseClasses.push_back(base);
+        for (size_t i = 0; i < base->methods.size(); ++i)
+        {
+            int k = methodIndex(base->methods[i]->name);
+            if (k < 0)
+            {
+                k = methods.size();
+                methods.push_back(base->methods[i]);
+            }
+            if (!first && (size_t) k != i)
+                base->markUnstable();
+        }
+        first = false;
+    }
+    vector<Symbol> own; // scopeHolder lists the newest declaration first
+    for (SymbolList p = scopeHolder ? scopeHolder->info : 0; p; p = p->next)
+        if (dynamic_cast<FuncSymbol *>(p->info))
+            own.push_back(p->info);
+    for (size_t i = own.size(); i-- > 0; )
+    {
+        int k = methodIndex(own[i]->name);
+        if (k < 0)
+            methods.push_back(own[i]);
+        else
+            methods[k] = own[i];
+    }
+
+    // Attributes are laid out the same way, so along first bases an
+    // attribute keeps its offset; each of this class's own attributes
+    // records its offset here in its slot.
+    fields.clear();
+    first = true;
+    for (TypeList b = bases; b; b = b->next)
+    {
+        ClassType * base = dynamic_cast<ClassType *>(rootType(b->info));
+        if (!base)
+            continue;
+        for (size_t i = 0; i < base->fields.size(); ++i)
+            if (first || fieldIndex(base->fields[i]->name) < 0)
+                fields.push_back(base->fields[i]);
+        first = false;
+    }
+    own.clear();
+    for (SymbolList p = scopeHolder ? scopeHolder->info : 0; p; p = p->next)
+        if (p->info->needsSlot())
+            own.push_back(p->info);
+    for (size_t i = own.size(); i-- > 0; )
+    {
+        int k = fieldIndex(own[i]->name);
+        if (k < 0)
+        {
+            k = fields.size();
+            fields.push_back(own[i]);
+        }
+        else
+            fields[k] = own[i];
+        own[i]->depth = -1;
+        own[i]->slot = k;
+    }
+}
+
 struct UndefinedSymbol
     : SymbolBlock
 {
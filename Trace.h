@@ -0,0 +1,104 @@
+// *** TRACING ***
+//
+// trace(category, a << b << ...) records a message in a ring buffer when
+// that category is enabled.  Trace points exist only in builds made with
+// -DTRACE=1; otherwise trace() expands to nothing and its operands are
+// never evaluated.  Categories are chosen at run time with -t, e.g.
+// -t scopes,types or -t all, and the buffer is dumped at exit.
+
+#ifndef TRACE
+#define TRACE 0
+#endif
+
+enum TraceCategory {traceScopes, traceLookups, traceTypes, traceParser, traceDebug,
+                    TRACE_CATEGORIES};
+
+inline const char * traceCategoryName(int c)
+{
+    static const char * names[TRACE_CATEGORIES] = {"scopes", "lookups", "types", "parser", "debug"};
+    return names[c];
+}
+
+struct TraceRing
+{
+    enum { SIZE = 4096 };
+
+    unsigned enabled; // bit per TraceCategory
+    long count;       // messages ever recorded
+    TraceCategory cats[SIZE];
+    string messages[SIZE];
+
+    TraceRing()
+        : enabled(0), count(0)
+    {
+    }
+
+    bool isEnabled(TraceCategory c)
+    {
+        return enabled & (1u << c);
+    }
+
+    void add(TraceCategory c, const string & msg)
+    {
+        cats[count % SIZE] = c;
+        messages[count % SIZE] = msg;
+        ++count;
+    }
+
+    bool enable(string spec) // comma separated category names or "all"
+    {
+        while (!spec.empty())
+        {
+            size_t comma = spec.find(',');
+            string name = spec.substr(0, comma);
+            spec = comma == string::npos ? "" : spec.substr(comma + 1);
+            int c = 0;
+            for (; c < TRACE_CATEGORIES; ++c)
+                if (name == traceCategoryName(c))
+                    break;
+            if (name == "all")
+                enabled = (1u << TRACE_CATEGORIES) - 1;
+            else if (c < TRACE_CATEGORIES)
+                enabled |= 1u << c;
+            else
+                return false;
+        }
+        return true;
+    }
+
+    void dump(ostream & out)
+    {
+        long first = count > SIZE ? count - SIZE : 0;
+        for (long i = first; i < count; ++i)
+            out << "--- TRACE " << traceCategoryName(cats[i % SIZE]) << ": "
+                << messages[i % SIZE] << endl;
+    }
+};
+
+inline TraceRing & traceRing()
+{
+    static TraceRing ring;
+    return ring;
+}
+
+#if TRACE
+#define trace(cat, msg) \
+    do { \
+        if (traceRing().isEnabled(cat)) \
+        { \
+            ostringstream trace_out; \
+            trace_out << msg; \
+            traceRing().add(cat, trace_out.str()); \
+        } \
+    } while (0)
+#else
+#define trace(cat, msg) ((void) 0)
+#endif
+
+// The old DEBUG hook, for callers outside this tree (the grammar actions):
+// msg is recorded under -t debug.
+inline void debug(const string & msg)
+{
+    trace(traceDebug, msg);
+    (void) msg; // unused when TRACE is 0
+}
@@ -1,53 +1,71 @@
+inline void requireFailed(const char * msg, Type t1, Type t2)
+{
+    ostringstream out;
+    out << msg << " required";
+    if (t1)
+    {
+        out << " (found " << t1;
+        if (t2)
+            out << ", " << t2;
+        out << ")";
+    }
+    diagnostics().report(semanticError, checkRow(), out.str());
+}
+
 inline void requireFuncType(Type t)
 {
-    require(t->behavior(isFunc), "function type");
+    require(t->behavior(isFunc), "function type", t);
 }
 
 inline void requireClassType(Type t)
 {
-    require(t->behavior(isClass), "class type");
+    require(t->behavior(isClass), "class type", t);
 }
 
 inline void requireListType(Type t)
 {
-    require(t->behavior(isList), "list type");
+    require(t->behavior(isList), "list type", t);
 }
 
 inline void requireIntType(Type t)
 {
-    require(t->behavior(isInt), "int type");
+    require(t->behavior(isInt), "int type", t);
 }
 
 inline void requireSameType(Type t1, Type t2)
 {
-    if (DEBUG) cout << "requireSameType: T1 = " << t1 << " T2 = " << t2 << endl;
-    require(t1->isSameType(t2), "same type");
+    trace(traceTypes, "requireSameType: T1 = " << t1 << " T2 = " << t2);
+    require(t1->isSameType(t2), "same type", t1, t2);
 }
 
 inline void requireSameIntType(Type t1, Type t2)
 {
-    require(t1->behavior(isInt) && t2->behavior(isInt), "same int type");
+    require(t1->behavior(isInt) && t2->behavior(isInt), "same int type", t1, t2);
 }
 
 inline void requireIntOrStrType(Type ty)
 {
-    require(ty->behavior(isInt) || ty->behavior(isStr), "int or str type");
+    require(ty->behavior(isInt) || ty->behavior(isStr), "int or str type", ty);
 }
 
 inline void requireBoolType(Type t)
 {
-    require(t->behavior(isBool), "bool type");
+    require(t->behavior(isBool), "bool type", t);
 }
 
 inline void requireBothBoolType(Type t1, Type t2)
 {
-    require(t1->behavior(isBool) && t2->behavior(isBool), "bool type");
+    require(t1->behavior(isBool) && t2->behavior(isBool), "bool type", t1, t2);
 }
 
 inline void requireArgMatch(SymbolList f, ExprList a)
 {
     for (; f && a; f = f->next, a = a->next)
-        require(f->info->type->isSameType(a->info->type), "argument type match");
+    {
+        CheckingRow at(a->info->row);
+        require(f->info->type->isSameType(a->info->type), "argument type match",
+                f->info->type, a->info->type);
+    }
     require(!a, "less arguments");
     require(!f, "more arguments");
 }
@@ -57,10 +75,14 @@ inline void requireAllSameType(ExprList a)
     if (!a) return;
     Type ty = a->info->type;
     for (ExprList p = a->next; p; p = p->next)
+    {
+        CheckingRow at(p->info->row);
         requireSameType(ty, p->info->type);
+    }
 }
 
 inline void requireLocation(Expr e)
 {
-    require(e->isLocation(), "location");
+    CheckingRow at(e->row);
+    require(e->isLocation(), "location", e->type);
 }
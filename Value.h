@@ -0,0 +1,594 @@
+// *** RUNTIME VALUES ***
+//
+// A Value is one 64-bit word.  The low two bits are a tag:
+//
+//     ..........01   int, the upper 62 bits sign-extended
+//     ..........00   pointer to a HeapObject (8-byte aligned, never 0)
+//     ....LLL...10   str of up to 7 bytes held in the word itself, with
+//                    length LLL in bits 2-4 and the bytes in bits 8-63
+//     ..........11   None, False or True (bits 2 and up: 0, 1, 2)
+//
+// so any-typed slots hold ints, bools, None and short strings without an
+// allocation.  Lists pick their storage from the checked element type:
+// [int] is an unboxed long long array, [bool] is bit-packed and anything
+// else holds Values.  A list probed by in / not in often enough builds a
+// hash index of its elements (see listContains).
+
+typedef long long Int;
+
+enum ValueTag {intTag = 1, ptrTag = 0, shortStrTag = 2, constTag = 3};
+
+struct HeapObject;
+
+// smallest and largest ints that fit unboxed; ints are 62-bit, and an
+// operation whose result does not fit traps
+#define MIN_VALUE_INT (-(1LL << 61))
+#define MAX_VALUE_INT ((1LL << 61) - 1)
+
+struct Value
+{
+    unsigned long long bits;
+
+    Value()
+        : bits(constTag) // None
+    {
+    }
+
+    explicit Value(unsigned long long b)
+        : bits(b)
+    {
+    }
+
+    static Value none() { return Value(constTag); }
+    static Value fromBool(bool b) { return Value((b ? 2 << 2 : 1 << 2) | constTag); }
+    static Value fromInt(Int i)
+    {
+        if (__builtin_expect(i < MIN_VALUE_INT || i > MAX_VALUE_INT, 0))
+            runtime_trap("int out of range");
+        return Value(((unsigned long long) i << 2) | intTag);
+    }
+
+    static Value fromObject(HeapObject * o) { return Value((unsigned long long) o); }
+
+    ValueTag tag() const { return ValueTag(bits & 3); }
+    bool isInt() const { return tag() == intTag; }
+    bool isObject() const { return tag() == ptrTag; }
+    bool isShortStr() const { return tag() == shortStrTag; }
+    bool isNone() const { return bits == constTag; }
+    bool isBool() const { return tag() == constTag && bits != constTag; }
+
+    Int asInt() const { return (Int) bits >> 2; }
+    bool asBool() const { return bits == ((2 << 2) | constTag); }
+    HeapObject * asObject() const { return (HeapObject *) bits; }
+
+    bool operator == (Value v) const { return bits == v.bits; }
+    bool operator != (Value v) const { return bits != v.bits; }
+};
+
+
+// *** HEAP OBJECTS ***
+
+enum HeapKind {strObj, intListObj, boolListObj, anyListObj, instanceObj};
+
+struct HeapObject
+{
+    HeapKind kind;
+    bool mature;     // survived a minor collection, lives outside the nursery
+    bool marked;     // reached during a major collection
+    bool remembered; // mature and possibly pointing into the nursery
+    HeapObject * forward; // its mature copy, once promoted
+
+    HeapObject(HeapKind k)
+        : kind(k), mature(false), marked(false), remembered(false), forward(0)
+    {
+    }
+};
+
+// A boxed str is the first size bytes of a buffer it may share with
+// longer strs: concatenation appends to the buffer in place when the left
+// operand ends at the buffer's end, so s = s + t in a loop is amortized
+// linear.  The bytes a str covers never change once written.
+struct StrObject
+    : HeapObject
+{
+    shared_ptr<string> buffer;
+    size_t size;
+
+    StrObject(const string & s)
+        : HeapObject(strObj), buffer(make_shared<string>(s)), size(s.size())
+    {
+    }
+
+    StrObject(shared_ptr<string> b, size_t n)
+        : HeapObject(strObj), buffer(b), size(n)
+    {
+    }
+
+    const char * data() const { return buffer->data(); }
+    bool extendsBuffer() const { return size == buffer->size(); }
+};
+
+// The elements of an int or any list, by value, for in / not in.  Ints and
+// strs are indexed by content; other elements have no stable key across
+// collections and are still found by scanning.
+struct ListIndex
+{
+    unordered_set<Int> ints;
+    unordered_set<string> strs;
+};
+
+struct IntListObject
+    : HeapObject
+{
+    vector<Int> elements;
+    int probes;                 // in / not in since the last mutation
+    unique_ptr<ListIndex> index;
+
+    IntListObject()
+        : HeapObject(intListObj), probes(0)
+    {
+    }
+};
+
+struct BoolListObject
+    : HeapObject
+{
+    vector<unsigned long long> words;
+    size_t size;
+
+    BoolListObject()
+        : HeapObject(boolListObj), size(0)
+    {
+    }
+
+    bool at(size_t i) const
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(size_t i, bool b)
+    {
+        if (b)
+            words[i / 64] |= 1ULL << (i % 64);
+        else
+            words[i / 64] &= ~(1ULL << (i % 64));
+    }
+
+    void push(bool b)
+    {
+        if (size % 64 == 0)
+            words.push_back(0);
+        set(size++, b);
+    }
+};
+
+struct AnyListObject
+    : HeapObject
+{
+    vector<Value> elements;
+    int probes;
+    unique_ptr<ListIndex> index;
+
+    AnyListObject()
+        : HeapObject(anyListObj), probes(0)
+    {
+    }
+};
+
+struct InstanceObject
+    : HeapObject
+{
+    ClassType * cls;
+    vector<Value> fields;
+
+    InstanceObject(ClassType * c, size_t nfields)
+        : HeapObject(instanceObj), cls(c), fields(nfields)
+    {
+    }
+};
+
+
+// Allocation and the write barrier belong to the collector (Heap.h).  Every
+// store of a Value into a heap object goes through writeBarrier.
+
+template <typename T, typename... Args>
+T * gcNew(Args... args);
+
+inline void writeBarrier(HeapObject * holder, Value v);
+
+inline void instanceSet(InstanceObject * o, size_t i, Value v)
+{
+    o->fields[i] = v;
+    writeBarrier(o, v);
+}
+
+
+// *** STRINGS ***
+
+inline Value makeStr(const char * s, size_t n)
+{
+    if (n > 7)
+        return Value::fromObject(gcNew<StrObject>(string(s, n)));
+    unsigned long long b = shortStrTag | (n << 2);
+    for (size_t i = 0; i < n; ++i)
+        b |= (unsigned long long) (unsigned char) s[i] << (8 * (i + 1));
+    return Value(b);
+}
+
+inline Value makeStr(const string & s)
+{
+    return makeStr(s.data(), s.size());
+}
+
+inline size_t strLength(Value v)
+{
+    if (v.isShortStr())
+        return (v.bits >> 2) & 7;
+    return static_cast<StrObject *>(v.asObject())->size;
+}
+
+inline char strCharAt(Value v, size_t i)
+{
+    if (v.isShortStr())
+        return (char) (v.bits >> (8 * (i + 1)));
+    return static_cast<StrObject *>(v.asObject())->data()[i];
+}
+
+inline string strString(Value v)
+{
+    if (!v.isShortStr())
+    {
+        StrObject * s = static_cast<StrObject *>(v.asObject());
+        return string(s->data(), s->size);
+    }
+    string s;
+    for (size_t i = 0, n = strLength(v); i < n; ++i)
+        s += strCharAt(v, i);
+    return s;
+}
+
+inline bool strEquals(Value a, Value b)
+{
+    if (a.isShortStr() || b.isShortStr())
+        return a == b; // a str that fits inline is never boxed
+    StrObject * s = static_cast<StrObject *>(a.asObject());
+    StrObject * t = static_cast<StrObject *>(b.asObject());
+    return s->size == t->size && (s->buffer == t->buffer || !memcmp(s->data(), t->data(), s->size));
+}
+
+// Appends the bytes of str v to buf.
+inline void strAppendTo(string & buf, Value v)
+{
+    if (v.isShortStr())
+        for (size_t i = 0, n = strLength(v); i < n; ++i)
+            buf += strCharAt(v, i);
+    else
+    {
+        StrObject * s = static_cast<StrObject *>(v.asObject());
+        buf.append(s->data(), s->size);
+    }
+}
+
+inline Value strConcat(Value a, Value b)
+{
+    size_t n = strLength(a) + strLength(b);
+    if (n <= 7)
+        return makeStr(strString(a) + strString(b));
+    shared_ptr<string> buf;
+    if (a.isObject() && static_cast<StrObject *>(a.asObject())->extendsBuffer())
+        buf = static_cast<StrObject *>(a.asObject())->buffer; // grow it in place
+    else
+    {
+        buf = make_shared<string>();
+        buf->reserve(2 * n);
+        strAppendTo(*buf, a);
+    }
+    strAppendTo(*buf, b);
+    return Value::fromObject(gcNew<StrObject>(buf, n)); // may move a and b, but buf is held
+}
+
+
+// *** LISTS ***
+
+// The representation for a list of the given checked element type.
+inline HeapObject * makeList(Type elementType)
+{
+    if (elementType && elementType->behavior(isInt) && !elementType->behavior(isAny))
+        return gcNew<IntListObject>();
+    if (elementType && elementType->behavior(isBool) && !elementType->behavior(isAny))
+        return gcNew<BoolListObject>();
+    return gcNew<AnyListObject>();
+}
+
+inline size_t listLength(HeapObject * l)
+{
+    switch (l->kind)
+    {
+        case intListObj: return static_cast<IntListObject *>(l)->elements.size();
+        case boolListObj: return static_cast<BoolListObject *>(l)->size;
+        default: return static_cast<AnyListObject *>(l)->elements.size();
+    }
+}
+
+// The element at index i of n, counting from the end when i is negative;
+// an index out of range traps.
+inline size_t elementIndex(Int i, Int n)
+{
+    if (i < 0)
+        i += n;
+    if (__builtin_expect(i < 0 || i >= n, 0))
+        runtime_trap("list index out of range");
+    return i;
+}
+
+inline size_t listIndex(HeapObject * l, Int i)
+{
+    return elementIndex(i, listLength(l));
+}
+
+// Generic IndexedExpr read; backends that know the element type call the
+// typed accessors directly and skip both the switch and the boxing.
+inline Value listGet(HeapObject * l, Int index)
+{
+    size_t i = listIndex(l, index);
+    switch (l->kind)
+    {
+        case intListObj: return Value::fromInt(static_cast<IntListObject *>(l)->elements[i]);
+        case boolListObj: return Value::fromBool(static_cast<BoolListObject *>(l)->at(i));
+        default: return static_cast<AnyListObject *>(l)->elements[i];
+    }
+}
+
+inline bool isStrValue(Value v)
+{
+    return v.isShortStr() || (v.isObject() && v.asObject()->kind == strObj);
+}
+
+inline bool isListValue(Value v)
+{
+    return v.isObject() && v.asObject()->kind != strObj && v.asObject()->kind != instanceObj;
+}
+
+// The one-byte str at index i of str v, counting from the end as for lists.
+inline Value strGet(Value v, Int i)
+{
+    Int n = strLength(v);
+    if (i < 0)
+        i += n;
+    if (i < 0 || i >= n)
+        runtime_trap("str index out of range");
+    char c = strCharAt(v, i);
+    return makeStr(&c, 1);
+}
+
+// Adds an element to a list's index, if it has one.
+template <typename ListObject>
+void indexElement(ListObject * l, Value v)
+{
+    if (!l->index)
+        return;
+    if (v.isInt())
+        l->index->ints.insert(v.asInt());
+    else if (isStrValue(v))
+        l->index->strs.insert(strString(v));
+}
+
+// An element store could remove an indexed value, so it drops the index.
+template <typename ListObject>
+void dropIndex(ListObject * l)
+{
+    l->index.reset();
+    l->probes = 0;
+}
+
+// An int or bool list holds nothing else; the checker guarantees it for
+// typed code, and a store that would break it traps.
+inline void checkElement(HeapObject * l, Value v)
+{
+    if (__builtin_expect((l->kind == intListObj && !v.isInt())
+                         || (l->kind == boolListObj && !v.isBool()), 0))
+        runtime_trap("list element of the wrong type");
+}
+
+inline void listSet(HeapObject * l, Int index, Value v)
+{
+    size_t i = listIndex(l, index);
+    checkElement(l, v);
+    switch (l->kind)
+    {
+        case intListObj:
+            static_cast<IntListObject *>(l)->elements[i] = v.asInt();
+            dropIndex(static_cast<IntListObject *>(l));
+            break;
+        case boolListObj: static_cast<BoolListObject *>(l)->set(i, v.asBool()); break;
+        default:
+            static_cast<AnyListObject *>(l)->elements[i] = v;
+            dropIndex(static_cast<AnyListObject *>(l));
+            writeBarrier(l, v);
+    }
+}
+
+inline void listAppend(HeapObject * l, Value v)
+{
+    checkElement(l, v);
+    switch (l->kind)
+    {
+        case intListObj:
+            static_cast<IntListObject *>(l)->elements.push_back(v.asInt());
+            indexElement(static_cast<IntListObject *>(l), v);
+            break;
+        case boolListObj: static_cast<BoolListObject *>(l)->push(v.asBool()); break;
+        default:
+            static_cast<AnyListObject *>(l)->elements.push_back(v);
+            indexElement(static_cast<AnyListObject *>(l), v);
+            writeBarrier(l, v);
+    }
+}
+
+inline bool valueEquals(Value a, Value b)
+{
+    if (a == b)
+        return true;
+    if ((a.isShortStr() || a.isObject()) && (b.isShortStr() || b.isObject())
+        && (a.isShortStr() || a.asObject()->kind == strObj)
+        && (b.isShortStr() || b.asObject()->kind == strObj))
+        return strEquals(a, b);
+    return false;
+}
+
+// ForStmt over a list: the kind is tested once, outside the loop, and
+// body(Value) sees each element in order.
+template <typename Body>
+void listForEach(HeapObject * l, Body body)
+{
+    switch (l->kind)
+    {
+        case intListObj:
+        {
+            vector<Int> & e = static_cast<IntListObject *>(l)->elements;
+            for (size_t i = 0; i < e.size(); ++i)
+                body(Value::fromInt(e[i]));
+            break;
+        }
+        case boolListObj:
+        {
+            BoolListObject * b = static_cast<BoolListObject *>(l);
+            for (size_t i = 0; i < b->size; ++i)
+                body(Value::fromBool(b->at(i)));
+            break;
+        }
+        default:
+        {
+            vector<Value> & e = static_cast<AnyListObject *>(l)->elements;
+            for (size_t i = 0; i < e.size(); ++i)
+                body(e[i]);
+        }
+    }
+}
+
+// l + m for the lists held in rooted slots a and b, which the allocation
+// may move: a new list with a's representation when b shares it, else an
+// any list.
+inline Value listConcat(const Value & a, const Value & b)
+{
+    HeapKind k = a.asObject()->kind == b.asObject()->kind ? a.asObject()->kind : anyListObj;
+    HeapObject * l;
+    if (k == intListObj)
+        l = gcNew<IntListObject>();
+    else if (k == boolListObj)
+        l = gcNew<BoolListObject>();
+    else
+        l = gcNew<AnyListObject>();
+    listForEach(a.asObject(), [l](Value v) { listAppend(l, v); });
+    listForEach(b.asObject(), [l](Value v) { listAppend(l, v); });
+    return Value::fromObject(l);
+}
+
+// A list of at least INDEX_MIN_SIZE elements gets an index on its
+// INDEX_AFTER_PROBES-th in / not in since it was last stored into; a
+// smaller or rarely probed list is cheaper to scan.
+enum { INDEX_MIN_SIZE = 32, INDEX_AFTER_PROBES = 8 };
+
+template <typename ListObject>
+bool wantsIndex(ListObject * l)
+{
+    return !l->index && ++l->probes >= INDEX_AFTER_PROBES && l->elements.size() >= INDEX_MIN_SIZE;
+}
+
+inline void buildIndex(IntListObject * l)
+{
+    l->index.reset(new ListIndex());
+    l->index->ints.insert(l->elements.begin(), l->elements.end());
+}
+
+inline void buildIndex(AnyListObject * l)
+{
+    l->index.reset(new ListIndex());
+    for (size_t i = 0; i < l->elements.size(); ++i)
+        indexElement(l, l->elements[i]);
+}
+
+// InExpr / NotInExpr
+inline bool listContains(HeapObject * l, Value v)
+{
+    switch (l->kind)
+    {
+        case intListObj:
+        {
+            if (!v.isInt())
+                return false;
+            IntListObject * il = static_cast<IntListObject *>(l);
+            if (wantsIndex(il))
+                buildIndex(il);
+            Int x = v.asInt();
+            if (il->index)
+                return il->index->ints.count(x) > 0;
+            vector<Int> & e = il->elements;
+            for (size_t i = 0; i < e.size(); ++i)
+                if (e[i] == x)
+                    return true;
+            return false;
+        }
+        case boolListObj:
+        {
+            if (!v.isBool())
+                return false;
+            BoolListObject * b = static_cast<BoolListObject *>(l);
+            unsigned long long miss = v.asBool() ? 0 : ~0ULL; // word with no match
+            for (size_t w = 0; w < b->words.size(); ++w)
+            {
+                unsigned long long valid = w + 1 < b->words.size() || b->size % 64 == 0
+                    ? ~0ULL : (1ULL << (b->size % 64)) - 1;
+                if ((b->words[w] ^ miss) & valid)
+                    return true;
+            }
+            return false;
+        }
+        default:
+        {
+            AnyListObject * al = static_cast<AnyListObject *>(l);
+            if (wantsIndex(al))
+                buildIndex(al);
+            if (al->index && v.isInt())
+                return al->index->ints.count(v.asInt()) > 0;
+            if (al->index && isStrValue(v))
+                return al->index->strs.count(strString(v)) > 0;
+            vector<Value> & e = al->elements;
+            for (size_t i = 0; i < e.size(); ++i)
+                if (valueEquals(e[i], v))
+                    return true;
+            return false;
+        }
+    }
+}
+
+inline void putValue(ostream & out, Value v)
+{
+    if (v.isInt())
+        out << v.asInt();
+    else if (v.isNone())
+        out << "None";
+    else if (v.isBool())
+        out << (v.asBool() ? "True" : "False");
+    else if (v.isShortStr() || v.asObject()->kind == strObj)
+        out << strString(v);
+    else if (v.asObject()->kind == instanceObj)
+        out << "<" << static_cast<InstanceObject *>(v.asObject())->cls->name << " object>";
+    else
+    {
+        HeapObject * l = v.asObject();
+        out << '[';
+        for (size_t i = 0, n = listLength(l); i < n; ++i)
+        {
+            if (i) out << ", ";
+            putValue(out, listGet(l, i));
+        }
+        out << ']';
+    }
+}
+
+inline ostream & operator << (ostream & out, Value v)
+{
+    putValue(out, v);
+    return out;
+}
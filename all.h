@@ -1,5 +1,23 @@
 using namespace std;
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <set>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <new>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+#include <unistd.h>
 
 #include "List.h"
 
@@ -18,13 +36,31 @@ typedef TypePair * TypeList;
 typedef ListPair<string> stringPair;
 typedef stringPair * stringList;
 
+typedef ListPair<int> intPair;
+typedef intPair * intList;
+
 #include "error.h"
+#include "Trace.h"
+#include "ScanUtils.h"
+#include "Arena.h"
 #include "Symbol.h"
 #include "SymTab.h"
 #include "Expr.h"
 #include "Stmt.h"
+#include "Compact.h"
 #include "SymUtils.h"
 #include "TypeUtils.h"
+#include "Escape.h"
+#include "Dispatch.h"
+#include "IR.h"
+#include "Value.h"
+#include "Heap.h"
+#include "Profile.h"
+#include "Jit.h"
+#include "Quicken.h"
+#include "IO.h"
+#include "Exec.h"
+#include "FrontEnd.h"
 
 void check(StmtList L);
 void do_homework(StmtList L);
@@ -32,3 +68,5 @@ void do_homework(StmtList L);
 #define STR_NAME "__str__"
 #define CONSTRUCTOR_NAME "__init__"
 #define RETURN_NAME "__RETURN__"
+#define MAIN_NAME "__main__"
+#define FIELDS_NAME "__fields__"
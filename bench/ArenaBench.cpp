@@ -0,0 +1,94 @@
+// Node allocation (Arena.h): building expression trees whose nodes come
+// from the node arena against the same node sizes from malloc, and a walk
+// over each tree, where the arena's adjacent nodes help the cache.  The
+// arena build also runs the make() factories, so it is an upper bound.  Build
+// against the -DLIBRARY=1 objects, as for tests/, with -O2:
+//
+//     g++ -std=c++11 -O2 -DLIBRARY=1 -I.. ArenaBench.cpp <library objects> -pthread
+//
+// and run with the number of leaves (default 4000000).
+
+#include "../all.h"
+
+static double seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// A binary node as malloc would hold it: the same size as a PlusExpr.
+struct MallocNode
+{
+    MallocNode * first;
+    MallocNode * second;
+    int value;
+};
+
+// A left-leaning sum of n leaves, as a parser reduces a + b + c + ...
+static Expr arenaTree(size_t n)
+{
+    Expr e = IntConstExpr::make(1000); // past the small-int cache: one node per leaf
+    for (size_t i = 1; i < n; ++i)
+        e = PlusExpr::make(e, IntConstExpr::make(1000 + i % 1000));
+    return e;
+}
+
+static MallocNode * mallocNode(MallocNode * first, MallocNode * second, int value)
+{
+    size_t size = first ? sizeof(PlusExpr) : sizeof(IntConstExpr);
+    MallocNode * m = static_cast<MallocNode *>(malloc(size < sizeof(MallocNode) ? sizeof(MallocNode) : size));
+    m->first = first;
+    m->second = second;
+    m->value = value;
+    return m;
+}
+
+static MallocNode * mallocTree(size_t n)
+{
+    MallocNode * e = mallocNode(0, 0, 1000);
+    for (size_t i = 1; i < n; ++i)
+        e = mallocNode(e, mallocNode(0, 0, 1000 + i % 1000), 0);
+    return e;
+}
+
+// Both walks follow the same n - 1 first links, without type tests.
+static long sum(Expr e, size_t n)
+{
+    long s = 0;
+    for (size_t i = 1; i < n; ++i, e = static_cast<PlusExpr *>(e)->first)
+        s += static_cast<IntConstExpr *>(static_cast<PlusExpr *>(e)->second)->value;
+    return s + static_cast<IntConstExpr *>(e)->value;
+}
+
+static long sum(MallocNode * e, size_t n)
+{
+    long s = 0;
+    for (size_t i = 1; i < n; ++i, e = e->first)
+        s += e->second->value;
+    return s + e->value;
+}
+
+int main(int argc, char * argv[])
+{
+    size_t n = argc > 1 ? atol(argv[1]) : 4000000;
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    Expr a = arenaTree(n);
+    double arenaBuild = seconds(t0);
+    t0 = chrono::steady_clock::now();
+    long arenaSum = sum(a, n);
+    double arenaWalk = seconds(t0);
+
+    t0 = chrono::steady_clock::now();
+    MallocNode * m = mallocTree(n);
+    double mallocBuild = seconds(t0);
+    t0 = chrono::steady_clock::now();
+    long mallocSum = sum(m, n);
+    double mallocWalk = seconds(t0);
+
+    cout << "arena:  build " << arenaBuild * 1e9 / n << " ns, walk " << arenaWalk * 1e9 / n
+         << " ns per leaf (sum " << arenaSum << ")" << endl;
+    cout << "malloc: build " << mallocBuild * 1e9 / n << " ns, walk " << mallocWalk * 1e9 / n
+         << " ns per leaf (sum " << mallocSum << ")" << endl;
+    nodeArena().put(cout);
+    return 0;
+}
@@ -0,0 +1,103 @@
+// AST memory, pointer tree against CompactAst (Compact.h), on a synthetic
+// program of defs built through the make() factories, as the parser would
+// build them.  Each def is 11 lines:
+//
+//     def fI(n: int, s: str) -> int:
+//         total: int = 0
+//         i: int = 0
+//         names: [str] = ["alpha", "beta", s]
+//         while i < n:
+//             if i % 3 == 0 and not i in [2, 5, 7]:
+//                 total = total + i * I
+//             else:
+//                 print(names[i % 3], i, "odd")
+//             i = i + 1
+//         return total - fJ(n - 1, s)
+//
+// Build against the -DLIBRARY=1 objects, as for tests/, with -O2:
+//
+//     g++ -std=c++11 -O2 -DLIBRARY=1 -I.. CompactBench.cpp <library objects> -pthread
+//
+// and run with the number of defs (default 90910, about 1,000,000 lines).
+// It prints the heap bytes the pointer tree took, the node arena's share
+// of them, the compact size, and how long packing and rebuilding took.
+
+#include "../all.h"
+#include <malloc.h>
+
+static double seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// A list of nodes built by hand, as in tests/Test.h.
+template <class T>
+ListPair<T> * list(std::initializer_list<T> items)
+{
+    ListPair<T> * head = 0;
+    for (const T * p = items.end(); p != items.begin(); )
+        head = new ListPair<T>(*--p, head);
+    return head;
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+static Expr num(int v) { return IntConstExpr::make(v); }
+static Expr str(const string & s) { return StrConstExpr::make(s); }
+
+static Stmt assign(const string & name, Expr value)
+{
+    return AssignStmt::make(AssignExpr::make(id(name), value));
+}
+
+static Stmt def(int k, int defs)
+{
+    string name = "f" + to_string(k), callee = "f" + to_string((k + 1) % defs);
+    StmtList params = list<Stmt>({ParamStmt::make("n", IntType::make()), ParamStmt::make("s", StrType::make())});
+    Stmt loop = WhileStmt::make(LTExpr::make(id("i"), id("n")), BlockStmt::make(list<Stmt>({
+        IfStmt::make(AndExpr::make(EQExpr::make(ModuloExpr::make(id("i"), num(3)), num(0)),
+                                   NotExpr::make(InExpr::make(id("i"),
+                                       ListExpr::make(list<Expr>({num(2), num(5), num(7)}))))),
+                     assign("total", PlusExpr::make(id("total"), TimesExpr::make(id("i"), num(k)))),
+                     CallStmt::make(PrintExpr::make(list<Expr>({
+                         IndexedExpr::make(id("names"), ModuloExpr::make(id("i"), num(3))), id("i"),
+                         str("odd")})))),
+        assign("i", PlusExpr::make(id("i"), num(1)))})));
+    return DefStmt::make(name, params, IntType::make(), BlockStmt::make(list<Stmt>({
+        VarStmt::make("total", IntType::make(), num(0)),
+        VarStmt::make("i", IntType::make(), num(0)),
+        VarStmt::make("names", ListType::make(StrType::make()),
+                      ListExpr::make(list<Expr>({str("alpha"), str("beta"), id("s")}))),
+        loop,
+        ReturnStmt::make(MinusExpr::make(id("total"),
+            CallExpr::make(id(callee), list<Expr>({MinusExpr::make(id("n"), num(1)), id("s")}))))})));
+}
+
+int main(int argc, char * argv[])
+{
+    int defs = argc > 1 ? atoi(argv[1]) : 90910;
+    size_t heapBefore = mallinfo2().uordblks, arenaBefore = nodeArena().used;
+    StmtList program = 0;
+    for (int k = defs; k-- > 0; )
+        program = new StmtPair(def(k, defs), program);
+    size_t pointerBytes = mallinfo2().uordblks - heapBefore, arenaBytes = nodeArena().used - arenaBefore;
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    CompactAst * c = CompactAst::make(program);
+    double packing = seconds(t0);
+    t0 = chrono::steady_clock::now();
+    StmtList rebuilt = c->statements();
+    double rebuilding = seconds(t0);
+
+    ostringstream before, after;
+    before << program;
+    after << rebuilt;
+    cout << defs << " defs, " << 11L * defs << " lines" << endl;
+    cout << "pointer AST: " << pointerBytes / 1e6 << " MB malloc'd (" << arenaBytes / 1e6
+         << " MB of it node arena)" << endl;
+    cout << "compact AST: " << c->bytes() / 1e6 << " MB" << endl;
+    c->put(cout);
+    cout << "packing " << packing << " s, rebuilding " << rebuilding << " s; the rebuilt tree prints "
+         << (before.str() == after.str() ? "the same " : "DIFFERENT ") << before.str().size() / 1e6
+         << " MB of text" << endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+// The baseline JIT (Jit.h) against the IR executor on an int loop:
+//
+//     def sumLinear(n): s = 0; i = 0
+//                        while i < n: s = s + i * 3 - 1; i = i + 1
+//                        return s
+//
+// called once interpreted and once compiled, with the results compared.
+// Build against the -DLIBRARY=1 objects, as for tests/, with -O2:
+//
+//     g++ -std=c++11 -O2 -DLIBRARY=1 -I.. JitBench.cpp <library objects> -pthread
+//
+// and run with n (default 10000000).
+
+#include "../all.h"
+
+static double seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// A list of nodes built by hand, as in tests/Test.h.
+template <class T>
+ListPair<T> * list(std::initializer_list<T> items)
+{
+    ListPair<T> * head = 0;
+    for (const T * p = items.end(); p != items.begin(); )
+        head = new ListPair<T>(*--p, head);
+    return head;
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+static Expr num(int v) { return IntConstExpr::make(v); }
+
+static Stmt assign(const string & name, Expr value)
+{
+    return AssignStmt::make(AssignExpr::make(id(name), value));
+}
+
+int main(int argc, char * argv[])
+{
+    Int n = argc > 1 ? atoll(argv[1]) : 10000000;
+    inlineBudget = 0;
+    jitThreshold = 0; // the executor interprets; the compiled code is called directly
+    Stmt def = DefStmt::make("sumLinear", list<Stmt>({ParamStmt::make("n", IntType::make())}), 0,
+        BlockStmt::make(list<Stmt>({
+            VarStmt::make("s", IntType::make(), num(0)), VarStmt::make("i", IntType::make(), num(0)),
+            WhileStmt::make(LTExpr::make(id("i"), id("n")), BlockStmt::make(list<Stmt>({
+                assign("s", MinusExpr::make(PlusExpr::make(id("s"), TimesExpr::make(id("i"), num(3))), num(1))),
+                assign("i", PlusExpr::make(id("i"), num(1)))}))),
+            ReturnStmt::make(id("s"))})));
+    IRModule * m = compileProgram(list<Stmt>({def}));
+    IRFunction * f = m->byName["sumLinear"];
+
+    Executor x(m);
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    Value interpreted = x.call(f, vector<Value>(1, Value::fromInt(n)));
+    double interpreting = seconds(t0);
+
+    t0 = chrono::steady_clock::now();
+    bool returnsBool;
+    JitCode code = compileIR(f, returnsBool);
+    double compiling = seconds(t0);
+    if (!code)
+    {
+        cout << "the JIT rejected sumLinear" << endl;
+        return 1;
+    }
+    t0 = chrono::steady_clock::now();
+    Int compiled = code(n, 0, 0, 0, 0, 0);
+    double running = seconds(t0);
+
+    cout << "interpreted: " << interpreting * 1e9 / n << " ns per iteration (" << interpreted << ")" << endl;
+    cout << "compiled:    " << running * 1e9 / n << " ns per iteration (" << compiled << "), compiling took "
+         << compiling * 1e6 << " us" << endl;
+    cout << (interpreted == Value::fromInt(compiled) ? "same result" : "RESULTS DIFFER") << endl;
+    return 0;
+}
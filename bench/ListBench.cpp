@@ -0,0 +1,48 @@
+// List indexing and iteration per representation (Value.h): an [int]
+// list is an unboxed array, [bool] is bit-packed and the rest hold
+// Values.  Build against the -DLIBRARY=1 objects, as for tests/, with -O2:
+//
+//     g++ -std=c++11 -O2 -DLIBRARY=1 -I.. ListBench.cpp <library objects> -pthread
+//
+// and run with the element count (default 10000000).
+
+#include "../all.h"
+
+static double seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+static void bench(const char * name, Type elementType, size_t n)
+{
+    HeapObject * l = makeList(elementType);
+    for (size_t i = 0; i < n; ++i)
+        listAppend(l, elementType == BoolType::make() ? Value::fromBool(i & 1)
+                      : Value::fromInt(i % 1000));
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    Int sum = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        Value v = listGet(l, i);
+        sum += v.isInt() ? v.asInt() : v.asBool();
+    }
+    double indexed = seconds(t0);
+
+    t0 = chrono::steady_clock::now();
+    listForEach(l, [&sum](Value v) { sum += v.isInt() ? v.asInt() : v.asBool(); });
+    double iterated = seconds(t0);
+
+    cout << name << ": index " << indexed * 1e9 / n << " ns, iterate "
+         << iterated * 1e9 / n << " ns per element (sum " << sum << ")" << endl;
+}
+
+int main(int argc, char * argv[])
+{
+    size_t n = argc > 1 ? atol(argv[1]) : 10000000;
+    bench("[int] ", IntType::make(), n);
+    bench("[bool]", BoolType::make(), n);
+    bench("[any] ", AnyType::make(), n);
+    heap().getStats().put(cout);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// The span scanners (ScanUtils.h) against a byte loop, on generated
+// source of indented lines of identifiers, numbers and operators:
+//
+//     def f12(alpha_3, n):
+//         total_7 = alpha_3 * 4096 + n
+//
+// Each pass splits the text into words, blank runs and single other
+// characters, and counts them; the counts must agree.  The last pass runs
+// the span scanners over chunks from splitAtLogicalLines on one thread per
+// core.  Build against the -DLIBRARY=1 objects, as for tests/, with -O2,
+// adding -mavx2 for the 32-byte path:
+//
+//     g++ -std=c++11 -O2 [-mavx2] -DLIBRARY=1 -I.. ScanBench.cpp <library objects> -pthread
+//
+// and run with the size in MB (default 300).
+
+#include "../all.h"
+
+static double seconds(chrono::steady_clock::time_point t0)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+static string source(size_t bytes)
+{
+    static const char * words[] = {"def", "total_7", "alpha_3", "n", "while", "return", "f12", "Student"};
+    static const char * ops[] = {" = ", " + ", " * ", ", ", "(", "):", " < "};
+    string s;
+    s.reserve(bytes + 128);
+    srand(2);
+    while (s.size() < bytes)
+    {
+        s.append(4 * (rand() % 3), ' ');
+        for (int k = 1 + rand() % 6; k > 0; --k)
+        {
+            s += rand() % 4 ? words[rand() % 8] : to_string(rand() % 100000);
+            s += ops[rand() % 7];
+        }
+        s += '\n';
+    }
+    return s;
+}
+
+static long byteLoop(const char * p, const char * end)
+{
+    long spans = 0;
+    while (p < end)
+    {
+        if (inCharClass(*p, isIdentChar))
+            while (p < end && inCharClass(*p, isIdentChar))
+                ++p;
+        else if (inCharClass(*p, isBlank))
+            while (p < end && inCharClass(*p, isBlank))
+                ++p;
+        else
+            ++p;
+        ++spans;
+    }
+    return spans;
+}
+
+static long spans(const char * p, const char * end)
+{
+    long n = 0;
+    while (p < end)
+    {
+        if (inCharClass(*p, isIdentChar))
+            p = scanIdentifier(p, end);
+        else if (inCharClass(*p, isBlank))
+            p = skipBlanks(p, end);
+        else
+            ++p;
+        ++n;
+    }
+    return n;
+}
+
+static void spanChunk(const char * b, const char * e, bool, vector<long> & out)
+{
+    out.push_back(spans(b, e));
+}
+
+int main(int argc, char * argv[])
+{
+    size_t mb = argc > 1 ? atol(argv[1]) : 300;
+    string s = source(mb << 20);
+    const char * b = s.data();
+    const char * e = b + s.size();
+    double size = s.size() / 1e6;
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    long byBytes = byteLoop(b, e);
+    double bytesTime = seconds(t0);
+
+    t0 = chrono::steady_clock::now();
+    long bySpans = spans(b, e);
+    double spansTime = seconds(t0);
+
+    // the chunks are cut at line starts, so no word straddles two of them
+    int parts = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1;
+    t0 = chrono::steady_clock::now();
+    vector<long> counts = scanInParallel<long>(b, s.size(), parts, spanChunk);
+    long inParallel = 0;
+    for (size_t k = 0; k < counts.size(); ++k)
+        inParallel += counts[k];
+    double parallelTime = seconds(t0);
+
+#if defined(__AVX2__)
+    const char * width = "AVX2";
+#elif defined(__SSE2__)
+    const char * width = "SSE2";
+#else
+    const char * width = "byte loop";
+#endif
+    cout << size << " MB, " << byBytes << " spans" << endl;
+    cout << "byte loop: " << size / bytesTime << " MB/s" << endl;
+    cout << "span scanners, " << width << ": " << size / spansTime << " MB/s" << endl;
+    cout << "span scanners in " << counts.size() << " chunks: " << size / parallelTime << " MB/s" << endl;
+    cout << (byBytes == bySpans && bySpans == inParallel ? "same counts" : "COUNTS DIFFER") << endl;
+    return 0;
+}
@@ -1,36 +1,131 @@
 extern int row;
-#define DEBUG 0
+
+// Every error is reported as a Diagnostic.  The command line echoes each
+// to cout as it is reported; checkSource (FrontEnd.h) turns the echo off
+// and hands the list to its caller.
+
+enum DiagnosticKind {lexicalError, syntaxError, semanticError, fatalError, runtimeError};
+
+struct Diagnostic
+{
+    DiagnosticKind kind;
+    int row;        // source line, or -1 if the message has none
+    string message;
+
+    void put(ostream & out) const
+    {
+        static const char * names[] = {"Lexical", "Syntax", "Semantic", "Fatal", "Runtime"};
+        out << "*** " << names[kind] << " Error";
+        if (row >= 0)
+            out << ' ' << row;
+        out << (kind == lexicalError ? ": " : ":") << message << endl;
+    }
+};
+
+struct DiagnosticLog
+{
+    vector<Diagnostic> list;
+    bool echo;
+
+    DiagnosticLog()
+        : echo(true)
+    {
+    }
+
+    void report(DiagnosticKind kind, int r, const string & message)
+    {
+        Diagnostic d = {kind, r, message};
+        list.push_back(d);
+        if (echo)
+            d.put(cout);
+    }
+};
+
+inline DiagnosticLog & diagnostics()
+{
+    static DiagnosticLog log;
+    return log;
+}
+
+// The scanner's row is only meaningful while parsing; by the time check()
+// runs it is the last line.  A check that can fail opens a CheckingRow
+// for the node it checks (CheckingRow at(row); in its check()), and
+// semantic errors report the innermost open row, or none.
+
+inline int & checkRow()
+{
+    static int r = -1;
+    return r;
+}
+
+struct CheckingRow
+{
+    int saved;
+
+    CheckingRow(int r)
+        : saved(checkRow())
+    {
+        checkRow() = r;
+    }
+
+    ~CheckingRow()
+    {
+        checkRow() = saved;
+    }
+};
 
 inline void lexical_error(char c)
 {
-    cout << "*** Lexical Error " << row << ": " << c << endl;
+    diagnostics().report(lexicalError, row, string(1, c));
 }
 
 inline void compiler_error(string s)
 {
-    cout << "*** Fatal Error:" << s << endl;
+    diagnostics().report(fatalError, -1, s);
 }
 
 inline void syntax_error(string s)
 {
-    cout << "*** Syntax Error " << row << ":" << s << endl;
+    diagnostics().report(syntaxError, row, s);
 }
 
 inline void semantic_error(string s)
 {
-    cout << "*** Semantic Error:" << s << endl;
+    diagnostics().report(semanticError, checkRow(), s);
 }
 
 #define yyerror(s) syntax_error(s)
 
+// A check that fails while a program runs (an int out of range, an index
+// past the end) throws a RuntimeTrap out of the operation; the engine
+// reports it as a runtimeError.
+struct RuntimeTrap
+{
+    string message;
+    int row; // of the statement that trapped, filled in by the engine
+};
 
-inline void require(bool cond, string msg)
+[[noreturn]] inline void runtime_trap(const string & s)
 {
-    if (!cond)
-        cout << "*** Semantic Error:" << msg << " required" << endl;
+    throw RuntimeTrap{s, -1};
 }
 
-inline void debug(string msg)
+
+// Checks almost always pass, so the message is a static string and the
+// offending types are passed through unformatted; only the cold
+// requireFailed builds any text.
+
+__attribute__((cold))
+inline void requireFailed(const char * msg, Type t1, Type t2);
+
+inline void require(bool cond, const char * msg, Type t1 = 0, Type t2 = 0)
 {
-    if (DEBUG) cout << "--- DEBUG: " << msg << endl;
+    if (__builtin_expect(!cond, 0))
+        requireFailed(msg, t1, t2);
+}
+
+inline void require(bool cond, const string & msg) // for composed messages
+{
+    if (!cond)
+        requireFailed(msg.c_str(), 0, 0);
 }
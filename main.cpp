@@ -1,20 +1,6 @@
-void check(StmtList L)
-{
-    for (StmtList p = L; p; p=p->next)
-        p->info->check();
-}
+#if !LIBRARY
 
-void do_homework(StmtList L)
-{
-    switch (HW)
-    {
-        case 3: cout << L << endl; break;
-        case 4:
-        case 5: check(L); break;
-        default:
-            compiler_error("Unknown homework option");
-    }
-}
+extern FILE * yyin;
 
 int scan1_main()
 {
@@ -42,23 +28,40 @@ int scan2_main()
     return 0;
 }
 
+// With -k the source is read up front to hash it; a cache hit skips the
+// front end, else the parser reads the copy while what it prints is kept
+// for the cache.
 void parse_main()
 {
+    if (!irCacheFile || (HW != 5 && HW != 6))
+    {
+        yyparse();
+        return;
+    }
+    string source((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+    irSourceHash = sourceHash(source);
+    if (runFromIRCache(irCacheFile, irSourceHash))
+        return;
+    TeeBuffer tee(cout);
+    frontEndOutput = &tee;
+    yyin = fmemopen(&source[0], source.size(), "r");
     yyparse();
+    frontEndOutput = 0;
 }
 
+// Options may come in any order: they are all read before the mode (the
+// last of -0 to -9) runs.
 int main(int argc, char *argv[])
 {
     int opt;
+    int mode = -1;
+    bool gcStatsAtExit = false;
+    const char * profileFile = 0;
     while (true)
-        switch ( opt = getopt(argc, argv, "0123456789") )
+        switch ( opt = getopt(argc, argv, "0123456789b:cegij:k:mp:t:") )
         {
             case '0':
-                scan1_main();
-                break;
             case '1':
-                scan2_main();
-                break;
             case '2':
             case '3':
             case '4':
@@ -67,13 +70,76 @@ int main(int argc, char *argv[])
             case '7':
             case '8':
             case '9':
-                HW = opt - '0';
-                parse_main();
+                mode = opt - '0';
+                break;
+            case 'b':
+                inlineBudget = atoi(optarg);
+                break;
+            case 'c':
+                profiler().counting = true;
+                break;
+            case 'e':
+                escapeReport = true;
+                break;
+            case 'g':
+                gcStatsAtExit = true;
+                break;
+            case 'i':
+                irDump = true;
+                break;
+            case 'j':
+                jitThreshold = atoi(optarg);
+                break;
+            case 'k':
+                irCacheFile = optarg;
+                break;
+            case 'm':
+                compactReport = true;
+                break;
+            case 'p':
+                profileFile = optarg;
+                if (!profiler().startSampling())
+                    cerr << "Cannot start the sampling timer" << endl;
+                break;
+            case 't':
+                if (!TRACE)
+                    cerr << "Tracing is not compiled in; rebuild with -DTRACE=1" << endl;
+                else if (!traceRing().enable(optarg))
+                    cerr << "Unknown trace category in: " << optarg << endl;
                 break;
             case -1:
+                if (mode == 0)
+                    scan1_main();
+                else if (mode == 1)
+                    scan2_main();
+                else if (mode > 1)
+                {
+                    HW = mode;
+                    if (compactReport)
+                        irCacheFile = 0; // a rebuilt tree has no rows to cache
+                    parse_main();
+                }
+                if (TRACE && traceRing().enabled)
+                    traceRing().dump(cerr);
+                if (gcStatsAtExit)
+                {
+                    heap().getStats().put(cerr);
+                    literalPool().put(cerr);
+                    ST.getStats().put(cerr);
+                }
+                if (profileFile)
+                {
+                    profiler().stopSampling();
+                    ofstream out(profileFile);
+                    profiler().putFolded(out);
+                }
+                if (profiler().counting)
+                    profiler().putCalls(cerr);
                 exit(0);
             default:
                 cerr << "Unknown program option: " << static_cast<char>(opt) << endl;
         }
     return 0;
 }
+
+#endif
@@ -0,0 +1,92 @@
+// The node arena (Arena.h): aligned, disjoint allocations, blocks reused
+// until full, Expr/Stmt nodes carved from it, and marks that destroy and
+// free what was built after them, symbols and types included.
+
+#include "Test.h"
+#include <malloc.h>
+
+int main()
+{
+    Arena a;
+    vector<pair<char *, size_t> > got;
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        size_t n = 1 + (i * 37) % 300;
+        if (i % 1000 == 999)
+            n = 3 * Arena::BLOCK_SIZE; // larger than a block
+        char * p = static_cast<char *>(a.allocate(n));
+        memset(p, int(i), n);
+        got.push_back(make_pair(p, n));
+    }
+    bool aligned = true, disjoint = true;
+    vector<pair<char *, size_t> > sorted(got);
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        aligned = aligned && (size_t(sorted[i].first) % Arena::ALIGN) == 0;
+        if (i > 0)
+            disjoint = disjoint && sorted[i - 1].first + sorted[i - 1].second <= sorted[i].first;
+    }
+    CHECK(aligned);
+    CHECK(disjoint);
+    bool intact = true; // later allocations never overwrote earlier ones
+    for (size_t i = 0; i < got.size(); ++i)
+        for (size_t j = 0; j < got[i].second; ++j)
+            intact = intact && got[i].first[j] == char(i);
+    CHECK(intact);
+    CHECK(a.blocks < got.size() / 10);
+
+    size_t before = nodeArena().used;
+    Expr e = PlusExpr::make(IdentExpr::make("x"), IdentExpr::make("y"));
+    Stmt s = ReturnStmt::make(e);
+    CHECK(nodeArena().used > before);
+    CHECK(nodeArena().used - before >= sizeof(PlusExpr) + 2 * sizeof(IdentExpr) + sizeof(ReturnStmt));
+    ostringstream out;
+    out << static_cast<ReturnStmt *>(s)->expr;
+    CHECK(out.str().find('x') != string::npos);
+
+    // as checkSource does per call: nodes built after a mark, their long
+    // names and the constants pooled among them all go on release
+    Arena & arena = nodeArena();
+    size_t heapBefore = mallinfo2().uordblks;
+    Arena::Mark m = arena.mark();
+    size_t usedAtMark = arena.used, blocksAtMark = arena.blocks;
+    string longName(200, 'n');
+    for (int i = 0; i < 20000; ++i)
+        AssignStmt::make(AssignExpr::make(IdentExpr::make(longName), StrConstExpr::make(longName + "!")));
+    CHECK(arena.owned.size() == 20000 * 3 + 1 && arena.blocks > blocksAtMark);
+    literalPool().reset();
+    arena.release(m);
+    CHECK(arena.used == usedAtMark && arena.blocks == blocksAtMark && arena.owned.empty() && !arena.marks);
+    CHECK(mallinfo2().uordblks < heapBefore + Arena::BLOCK_SIZE);
+    out.str("");
+    out << static_cast<ReturnStmt *>(s)->expr; // built before the mark, so kept
+    CHECK(out.str().find('x') != string::npos);
+    CHECK(StrConstExpr::make(longName + "!") != 0);
+
+    // symbols and types go the same way; the builtin types outlive the mark
+    heapBefore = mallinfo2().uordblks;
+    m = arena.mark();
+    usedAtMark = arena.used;
+    Type builtinInt = IntType::make();
+    for (int i = 0; i < 20000; ++i)
+        VarSymbol::make(longName, ListType::make(IntType::make()));
+    CHECK(arena.owned.size() == 20000 * 2 && arena.used > usedAtMark);
+    arena.release(m);
+    CHECK(arena.used == usedAtMark && arena.owned.empty());
+    CHECK(mallinfo2().uordblks < heapBefore + Arena::BLOCK_SIZE);
+    CHECK(IntType::make() == builtinInt && builtinInt->behavior(isInt));
+
+    // checking the same source again takes no more of the arena
+    const char * source = "x: int = 1\nprint(x)\n";
+    checkSource(source, strlen(source));
+    size_t usedAfterOne = arena.used;
+    for (int i = 0; i < 5; ++i)
+    {
+        CheckResult r = checkSource(source, strlen(source));
+        CHECK(SymTab::findSymbolInList("int", r.globals) != 0);
+    }
+    CHECK(arena.used == usedAfterOne);
+    CHECK(ST.findSymbol("int")->type == builtinInt);
+    return testResult();
+}
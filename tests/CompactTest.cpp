@@ -0,0 +1,83 @@
+// The compact AST (Compact.h): a program packed and rebuilt prints the same
+// as the original, packs again to the same arrays, and keeps its types as
+// CompactTypes rather than pointers into the tree it came from.
+
+#include "Test.h"
+
+static Stmt block(std::initializer_list<Stmt> stmts)
+{
+    return BlockStmt::make(list<Stmt>(stmts));
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+static Expr num(int v) { return IntConstExpr::make(v); }
+
+static string text(StmtList L)
+{
+    ostringstream out;
+    out << L;
+    return out.str();
+}
+
+static bool sameArrays(CompactAst * a, CompactAst * b)
+{
+    if (a->nodes.size() != b->nodes.size() || a->types.size() != b->types.size())
+        return false;
+    for (size_t i = 0; i < a->nodes.size(); ++i)
+        if (memcmp(&a->nodes[i], &b->nodes[i], sizeof(CompactNode)) != 0)
+            return false;
+    for (size_t i = 0; i < a->types.size(); ++i)
+        if (a->types[i].kind != b->types[i].kind || a->types[i].ref != b->types[i].ref)
+            return false;
+    return a->operands == b->operands && a->chars == b->chars && a->names == b->names;
+}
+
+int main()
+{
+    Type base = IdentType::make("Base");
+    Type rows = ListType::make(ListType::make(IntType::make()));
+    StmtList program = list<Stmt>({
+        // class Point(Base): x: int = 0
+        //                    def norm(self) -> int: return self.x * self.x
+        ClassStmt::make("Point", list<Type>({base}), block({
+            VarStmt::make("x", IntType::make(), num(0)),
+            DefStmt::make("norm", list<Stmt>({ParamStmt::make("self", 0)}), IntType::make(),
+                ReturnStmt::make(TimesExpr::make(SelectedExpr::make(id("self"), "x"),
+                                                 SelectedExpr::make(id("self"), "x"))))})),
+        // table: [[int]] = [[1, 2], [3, -4]]
+        VarStmt::make("table", rows, ListExpr::make(list<Expr>({
+            ListExpr::make(list<Expr>({num(1), num(2)})),
+            ListExpr::make(list<Expr>({num(3), UnaryMinusExpr::make(num(4))}))}))),
+        // for row in table: if row[0] < 2 and not False: print(row, "small") else: pass
+        ForStmt::make("row", id("table"),
+            IfStmt::make(AndExpr::make(LTExpr::make(IndexedExpr::make(id("row"), num(0)), num(2)),
+                                       NotExpr::make(BoolConstExpr::make(0))),
+                         CallStmt::make(PrintExpr::make(list<Expr>({id("row"), StrConstExpr::make("small")}))),
+                         PassStmt::make())),
+        // p = Point(); while p.norm() != 9: p.x = p.x + 1
+        AssignStmt::make(AssignExpr::make(id("p"), ObjConstrExpr::make("Point", 0))),
+        WhileStmt::make(NEExpr::make(CallExpr::make(SelectedExpr::make(id("p"), "norm"), 0), num(9)),
+            AssignStmt::make(AssignExpr::make(SelectedExpr::make(id("p"), "x"),
+                                              PlusExpr::make(SelectedExpr::make(id("p"), "x"), num(1))))),
+        CallStmt::make(PrintExpr::make(list<Expr>({NoneConstExpr::make(), InExpr::make(num(3), id("table"))})))});
+
+    CompactAst * packed = CompactAst::make(program);
+    StmtList rebuilt = packed->statements();
+    CHECK(text(rebuilt) == text(program));
+    CompactAst * again = CompactAst::make(rebuilt);
+    CHECK(sameArrays(packed, again));
+    CHECK(packed->bytes() == again->bytes());
+
+    // [[int]] is a list of a list of int, each type stored once
+    size_t lists = 0;
+    for (size_t i = 0; i < packed->types.size(); ++i)
+        lists += packed->types[i].kind == typeList;
+    CHECK(lists == 2);
+    bool named = false;
+    for (size_t i = 0; i < packed->types.size(); ++i)
+        named = named || (packed->types[i].kind == typeIdent
+                          && string(packed->name(packed->types[i].ref)) == "Base");
+    CHECK(named);
+    CHECK(packed->nodes.size() * sizeof(CompactNode) <= packed->bytes());
+    return testResult();
+}
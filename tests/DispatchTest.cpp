@@ -0,0 +1,39 @@
+// Method tables (Symbol.h, Dispatch.h): a class whose methods a subclass
+// moved, and every ancestor of it, is flagged so its calls go through the
+// inline cache instead of a fixed index.
+
+#include "Test.h"
+
+// Declares class name with methods names and builds its table.
+static ClassType * defineClass(SymTab & st, const string & name, TypeList bases,
+                               const vector<string> & names)
+{
+    ClassType * ct = static_cast<ClassType *>(ClassType::make(0));
+    Symbol cs = ClassSymbol::make(name, ct);
+    st.declare(cs);
+    st.enterScope(name, 0, cs);
+    for (size_t i = 0; i < names.size(); ++i)
+        st.declare(FuncSymbol::make(names[i], 0, FuncType::make(names[i], 0, IntType::make())));
+    ct->scopeHolder = new SymbolListPair(st.exitScope(), 0);
+    ct->buildMethodTable(bases);
+    return ct;
+}
+
+int main()
+{
+    SymTab st;
+    ClassType * d = defineClass(st, "D", 0, {"d"});
+    ClassType * b = defineClass(st, "B", list<Type>({d}), {"b"});
+    ClassType * a = defineClass(st, "A", 0, {"a1", "a2"});
+    CHECK(b->methodIndex("d") == 0 && b->methodIndex("b") == 1);
+    CHECK(!a->unstableIndices && !b->unstableIndices && !d->unstableIndices);
+
+    // class C(A, B): B's methods, D's included, follow A's
+    ClassType * c = defineClass(st, "C", list<Type>({a, b}), {"c"});
+    CHECK(c->methodIndex("a1") == 0 && c->methodIndex("d") == 2 && c->methodIndex("b") == 3);
+    CHECK(b->unstableIndices);
+    CHECK(d->unstableIndices); // a D-typed receiver may hold a C
+    CHECK(!a->unstableIndices); // along first bases indices are kept
+    CHECK(!c->unstableIndices);
+    return testResult();
+}
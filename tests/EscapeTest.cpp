@@ -0,0 +1,67 @@
+// Escape analysis (Escape.h): a local object stays in its def's frame
+// only if neither the def nor the __init__ its class runs lets it out.
+
+#include "Test.h"
+
+static Stmt block(std::initializer_list<Stmt> stmts)
+{
+    return BlockStmt::make(list<Stmt>(stmts));
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+
+static Stmt init(std::initializer_list<Stmt> params, Stmt body)
+{
+    return DefStmt::make(CONSTRUCTOR_NAME, list<Stmt>(params), 0, body);
+}
+
+static Type named(const string & name)
+{
+    Type t = ClassType::make(0);
+    t->name = name;
+    return t;
+}
+
+// def name(): o = cls(); print(o.v)
+static Stmt user(const string & name, const string & cls, ObjConstrExpr *& alloc)
+{
+    alloc = static_cast<ObjConstrExpr *>(ObjConstrExpr::make(cls, 0));
+    return DefStmt::make(name, 0, 0, block({
+        VarStmt::make("o", 0, alloc),
+        CallStmt::make(PrintExpr::make(list<Expr>({SelectedExpr::make(id("o"), "v")})))}));
+}
+
+int main()
+{
+    Stmt self = ParamStmt::make("self", 0);
+    Expr selfV = SelectedExpr::make(id("self"), "v");
+    // class Keeps: def __init__(self): self.v = 1
+    Stmt keeps = ClassStmt::make("Keeps", 0,
+        init({self}, AssignStmt::make(AssignExpr::make(selfV, IntConstExpr::make(1)))));
+    // class Leaks: def __init__(self): register(self)
+    Stmt leaks = ClassStmt::make("Leaks", 0, block({
+        init({self}, CallStmt::make(CallExpr::make(id("register"), list<Expr>({id("self")}))))}));
+    // class Cycle: def __init__(self): self.v = self
+    Stmt cycle = ClassStmt::make("Cycle", 0,
+        init({self}, AssignStmt::make(AssignExpr::make(selfV, id("self")))));
+    // class Inherits(Leaks): pass
+    Stmt inherits = ClassStmt::make("Inherits", list<Type>({named("Leaks")}), PassStmt::make());
+    // class Overrides(Leaks): def __init__(self): self.v = 1
+    Stmt overrides = ClassStmt::make("Overrides", list<Type>({named("Leaks")}),
+        init({self}, AssignStmt::make(AssignExpr::make(selfV, IntConstExpr::make(1)))));
+    // class Bare: pass
+    Stmt bare = ClassStmt::make("Bare", 0, PassStmt::make());
+
+    ObjConstrExpr * a[6];
+    analyzeEscapes(list<Stmt>({keeps, leaks, cycle, inherits, overrides, bare,
+        user("a", "Keeps", a[0]), user("b", "Leaks", a[1]), user("c", "Cycle", a[2]),
+        user("d", "Inherits", a[3]), user("e", "Overrides", a[4]), user("f", "Bare", a[5])}));
+    CHECK(a[0]->inFrame);
+    CHECK(!a[1]->inFrame);
+    CHECK(!a[2]->inFrame);
+    CHECK(!a[3]->inFrame); // the inherited __init__ leaks
+    CHECK(a[4]->inFrame);
+    CHECK(a[5]->inFrame);  // no __init__ runs
+    CHECK(escapeStats.allocations == 6 && escapeStats.stackAllocated == 3);
+    return testResult();
+}
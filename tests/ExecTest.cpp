@@ -0,0 +1,202 @@
+// The IR executor (Exec.h): whole programs built by hand, compiled and
+// run, with their output read back; traps with their rows; and objects
+// that must survive the collections a long loop causes.
+
+#include "Test.h"
+
+static Stmt block(std::initializer_list<Stmt> stmts)
+{
+    return BlockStmt::make(list<Stmt>(stmts));
+}
+
+static Stmt printStmt(std::initializer_list<Expr> args)
+{
+    return CallStmt::make(PrintExpr::make(list<Expr>(args)));
+}
+
+static Stmt assign(Expr target, Expr value)
+{
+    return AssignStmt::make(AssignExpr::make(target, value));
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+static Expr num(int v) { return IntConstExpr::make(v); }
+static Expr str(const string & s) { return StrConstExpr::make(s); }
+
+static Expr call(const string & fn, std::initializer_list<Expr> args)
+{
+    return CallExpr::make(id(fn), list<Expr>(args));
+}
+
+static Stmt param(const string & name)
+{
+    return ParamStmt::make(name, AnyType::make());
+}
+
+static Type named(const string & name)
+{
+    Type t = ClassType::make(0);
+    t->name = name;
+    return t;
+}
+
+// Compiles and runs the program; its output, and whether it ran to the end.
+static string run(std::initializer_list<Stmt> program, bool & ok)
+{
+    char path[] = "/tmp/ExecTestXXXXXX";
+    int fd = mkstemp(path);
+    int saved = dup(1);
+    cout.flush();
+    dup2(fd, 1);
+    ok = runProgram(compileProgram(list<Stmt>(program)));
+    dup2(saved, 1);
+    close(saved);
+    close(fd);
+    ifstream in(path);
+    string out((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    remove(path);
+    return out;
+}
+
+static string run(std::initializer_list<Stmt> program)
+{
+    bool ok;
+    string out = run(program, ok);
+    CHECK(ok);
+    return out;
+}
+
+int main()
+{
+    diagnostics().echo = false;
+
+    // def fib(n): if n < 2: return n
+    //             return fib(n - 1) + fib(n - 2)
+    Stmt fib = DefStmt::make("fib", list<Stmt>({param("n")}), 0, block({
+        IfStmt::make(LTExpr::make(id("n"), num(2)), ReturnStmt::make(id("n")), 0),
+        ReturnStmt::make(PlusExpr::make(call("fib", {MinusExpr::make(id("n"), num(1))}),
+                                        call("fib", {MinusExpr::make(id("n"), num(2))})))}));
+    CHECK(run({fib, printStmt({call("fib", {num(20)})})}) == "6765\n");
+
+    // / and % round toward negative infinity
+    CHECK(run({printStmt({DivideExpr::make(UnaryMinusExpr::make(num(7)), num(2)),
+                          ModuloExpr::make(UnaryMinusExpr::make(num(7)), num(2)),
+                          ModuloExpr::make(num(7), UnaryMinusExpr::make(num(2)))})}) == "-4 1 -1\n");
+
+    CHECK(run({printStmt({PlusExpr::make(str("ab"), str("cdefghij")), call("len", {str("hello")}),
+                          IndexedExpr::make(str("hello"), num(1)), InExpr::make(str("ell"), str("hello")),
+                          LTExpr::make(num(1), num(2)), NotExpr::make(BoolConstExpr::make(1))})})
+          == "abcdefghij 5 e True True False\n");
+
+    // l = [1, 2, 3]; l[-1] = 9; for x in l: t = t + x
+    CHECK(run({assign(id("l"), ListExpr::make(list<Expr>({num(1), num(2), num(3)}))),
+               assign(IndexedExpr::make(id("l"), UnaryMinusExpr::make(num(1))), num(9)),
+               assign(id("t"), num(0)),
+               ForStmt::make("x", id("l"), assign(id("t"), PlusExpr::make(id("t"), id("x")))),
+               printStmt({id("l"), PlusExpr::make(id("l"), ListExpr::make(list<Expr>({num(4)}))),
+                          InExpr::make(num(9), id("l")), id("t")})})
+          == "[1, 2, 9] [1, 2, 9, 4] True 12\n");
+
+    // class A: x = 1
+    //          def __init__(self, y): self.y = y
+    //          def get(self): return self.x + self.y
+    // class B(A): z = 10
+    Expr self = id("self");
+    Stmt a = ClassStmt::make("A", 0, block({
+        VarStmt::make("x", IntType::make(), num(1)),
+        DefStmt::make(CONSTRUCTOR_NAME, list<Stmt>({param("self"), param("y")}), 0,
+                      assign(SelectedExpr::make(self, "y"), id("y"))),
+        DefStmt::make("get", list<Stmt>({param("self")}), 0,
+                      ReturnStmt::make(PlusExpr::make(SelectedExpr::make(self, "x"),
+                                                      SelectedExpr::make(self, "y"))))}));
+    Stmt b = ClassStmt::make("B", list<Type>({named("A")}), VarStmt::make("z", IntType::make(), num(10)));
+    Expr obj = id("b");
+    CHECK(run({a, b, assign(obj, ObjConstrExpr::make("B", list<Expr>({num(5)}))),
+               printStmt({CallExpr::make(SelectedExpr::make(obj, "get"), 0),
+                          SelectedExpr::make(obj, "z"), SelectedExpr::make(obj, "x"), obj})})
+          == "6 10 1 <B object>\n");
+
+    // a trap ends the run after the output so far, at the row of its statement
+    bool ok;
+    row = 6;
+    Stmt before = printStmt({str("before")});
+    Stmt zero = assign(id("z"), num(0));
+    row = 7;
+    Stmt divide = printStmt({DivideExpr::make(num(1), id("z"))});
+    row = 8;
+    Stmt after = printStmt({str("after")});
+    CHECK(run({before, zero, divide, after}, ok) == "before\n" && !ok);
+    vector<Diagnostic> & d = diagnostics().list;
+    CHECK(d.size() == 1 && d[0].kind == runtimeError && d[0].row == 7);
+    CHECK(d.size() == 1 && d[0].message == "division by zero");
+
+    d.clear();
+    Stmt loop = DefStmt::make("loop", 0, 0, CallStmt::make(call("loop", {})));
+    CHECK(run({loop, CallStmt::make(call("loop", {}))}, ok) == "" && !ok);
+    CHECK(d.size() == 1 && d[0].message == "recursion too deep");
+
+    d.clear();
+    run({printStmt({IndexedExpr::make(ListExpr::make(list<Expr>({num(1)})), num(1))})}, ok);
+    CHECK(!ok && d.size() == 1 && d[0].message == "list index out of range");
+    d.clear();
+    run({printStmt({PlusExpr::make(str("a"), ListExpr::make(list<Expr>({num(1)})))})}, ok);
+    CHECK(!ok && d.size() == 1 && d[0].message == "unsupported operand types for +");
+    d.clear();
+    run({printStmt({id("q")})}, ok);
+    CHECK(!ok && d.size() == 1 && d[0].message == "name q is not defined");
+    d.clear();
+    run({printStmt({TimesExpr::make(num(1 << 30), TimesExpr::make(num(1 << 30), num(4)))})}, ok);
+    CHECK(!ok && d.size() == 1 && d[0].message == "int out of range");
+
+    // def g(n, m): while n > 0: print(m + m); n = n - 1
+    // g(0, 2 ** 60) never computes m + m, so it cannot trap
+    d.clear();
+    Stmt g = DefStmt::make("g", list<Stmt>({param("n"), param("m")}), 0,
+        WhileStmt::make(GTExpr::make(id("n"), num(0)), block({printStmt({PlusExpr::make(id("m"), id("m"))}),
+                                                             assign(id("n"), MinusExpr::make(id("n"), num(1)))})));
+    CHECK(run({g, CallStmt::make(call("g", {num(0), TimesExpr::make(num(1 << 30), num(1 << 30))})),
+               printStmt({num(7)})}) == "7\n");
+    CHECK(d.empty());
+
+    // keep = ["a long str one", A(7)]
+    // while i < 300000: junk = [s + s, i]; i = i + 1
+    // everything reachable from keep, the globals and the frames survives
+    // the collections the garbage causes
+    long minor = heap().getStats().minorCollections;
+    d.clear();
+    CHECK(run({a,
+               assign(id("keep"), ListExpr::make(list<Expr>({str("a long str one"),
+                                                             ObjConstrExpr::make("A", list<Expr>({num(7)}))}))),
+               assign(id("s"), str("0123456789")),
+               assign(id("i"), num(0)),
+               WhileStmt::make(LTExpr::make(id("i"), num(300000)), block({
+                   assign(id("junk"), ListExpr::make(list<Expr>({PlusExpr::make(id("s"), id("s")), id("i")}))),
+                   assign(id("i"), PlusExpr::make(id("i"), num(1)))})),
+               printStmt({IndexedExpr::make(id("keep"), num(0)),
+                          CallExpr::make(SelectedExpr::make(IndexedExpr::make(id("keep"), num(1)), "get"), 0),
+                          id("junk")})})
+          == "a long str one 8 [01234567890123456789, 299999]\n");
+    CHECK(heap().getStats().minorCollections >= minor + 2);
+    CHECK(d.empty());
+
+    // def f(n: int): while i < 300000: junk = [s + s, i]; i = i + 1
+    //                print(n)
+    // f(held), where held = [s + "!"] is an any: the int param holds a
+    // list, which the collections inside the call must still update
+    int budget = inlineBudget;
+    inlineBudget = 0;
+    minor = heap().getStats().minorCollections;
+    Stmt f = DefStmt::make("f", list<Stmt>({ParamStmt::make("n", IntType::make())}), 0, block({
+        assign(id("i"), num(0)),
+        WhileStmt::make(LTExpr::make(id("i"), num(300000)), block({
+            assign(id("junk"), ListExpr::make(list<Expr>({PlusExpr::make(id("s"), id("s")), id("i")}))),
+            assign(id("i"), PlusExpr::make(id("i"), num(1)))})),
+        printStmt({id("n")})}));
+    CHECK(run({f, assign(id("s"), str("0123456789")),
+               VarStmt::make("held", AnyType::make(), ListExpr::make(list<Expr>({PlusExpr::make(id("s"), str("!"))}))),
+               CallStmt::make(call("f", {id("held")}))})
+          == "[0123456789!]\n");
+    CHECK(heap().getStats().minorCollections >= minor + 2);
+    inlineBudget = budget;
+    return testResult();
+}
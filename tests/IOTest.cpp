@@ -0,0 +1,89 @@
+// Runtime I/O (IO.h): print's formatting, its order against what the front
+// end writes through cout, input() lines from a file, and both driven by a
+// program under the executor.
+
+#include "Test.h"
+
+// A temp file holding text, open for reading at its start.
+static int fileWith(const string & text)
+{
+    char path[] = "/tmp/IOTestXXXXXX";
+    int fd = mkstemp(path);
+    remove(path);
+    ssize_t n = write(fd, text.data(), text.size());
+    (void) n;
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+// Everything written to fd 1 while body runs.
+template <typename Body>
+static string captured(Body body)
+{
+    char path[] = "/tmp/IOTestXXXXXX";
+    int fd = mkstemp(path);
+    cout.flush();
+    int saved = dup(1);
+    dup2(fd, 1);
+    body();
+    runtimeOut().flush();
+    cout.flush();
+    dup2(saved, 1);
+    close(saved);
+    close(fd);
+    ifstream in(path);
+    string out((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    remove(path);
+    return out;
+}
+
+int main()
+{
+    // the front end's cout output and the program's stay in order
+    HeapObject * l = makeList(IntType::make());
+    listAppend(l, Value::fromInt(-3));
+    Value args[] = {Value::fromInt(MIN_VALUE_INT), Value::fromBool(false), Value(), makeStr("short"),
+                    makeStr("a str of some length"), Value::fromObject(l)};
+    CHECK(captured([&] {
+              cout << "checked\n";
+              runtimePrint(args, 6);
+              runtimeOut().flush();
+              cout << "stats\n";
+          })
+          == "checked\n-2305843009213693952 False None short a str of some length [-3]\nstats\n");
+
+    // a put larger than the buffer goes out directly, after what was buffered
+    string big(100000, 'x');
+    CHECK(captured([&] {
+              runtimeOut().put('<');
+              runtimeOut().put(big.data(), big.size());
+              runtimeOut().put('>');
+          })
+          == "<" + big + ">");
+
+    // lines, an empty one, one longer than the read buffer, and a last one
+    // with no newline
+    InBuffer in(fileWith("one\n\n" + big + "\nlast"));
+    StrView line;
+    CHECK(in.readLine(line) && line.str() == "one");
+    CHECK(in.readLine(line) && line.size == 0);
+    CHECK(in.readLine(line) && line.str() == big);
+    CHECK(in.readLine(line) && line.str() == "last");
+    CHECK(!in.readLine(line));
+
+    // print("name?"); n = input(); print(n + "!")
+    // the prompt is out before input() reads
+    diagnostics().echo = false;
+    int saved = dup(0);
+    dup2(fileWith("world\n"), 0);
+    Stmt program = BlockStmt::make(list<Stmt>({
+        CallStmt::make(PrintExpr::make(list<Expr>({StrConstExpr::make("name?")}))),
+        AssignStmt::make(AssignExpr::make(IdentExpr::make("n"), InputExpr::make())),
+        CallStmt::make(PrintExpr::make(list<Expr>({PlusExpr::make(IdentExpr::make("n"),
+                                                                  StrConstExpr::make("!"))})))}));
+    CHECK(captured([&] { CHECK(runProgram(compileProgram(list<Stmt>({program})))); })
+          == "name?\nworld!\n");
+    dup2(saved, 0);
+    close(saved);
+    return testResult();
+}
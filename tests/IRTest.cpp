@@ -0,0 +1,261 @@
+// The IR (IR.h): lowering, the passes and the cache file, on trees built
+// by hand.
+
+#include "Test.h"
+
+static Stmt block(std::initializer_list<Stmt> stmts)
+{
+    return BlockStmt::make(list<Stmt>(stmts));
+}
+
+static Stmt printStmt(std::initializer_list<Expr> args)
+{
+    return CallStmt::make(PrintExpr::make(list<Expr>(args)));
+}
+
+static DefStmt * def(const string & name, Stmt body)
+{
+    return static_cast<DefStmt *>(DefStmt::make(name, 0, 0, body));
+}
+
+// def name(n, m): body, with n and m untyped
+static DefStmt * def2(const string & name, Stmt body)
+{
+    StmtList params = list<Stmt>({ParamStmt::make("n", AnyType::make()), ParamStmt::make("m", AnyType::make())});
+    return static_cast<DefStmt *>(DefStmt::make(name, params, 0, body));
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+static Expr num(int v) { return IntConstExpr::make(v); }
+
+static Stmt assign(const string & name, Expr value)
+{
+    return AssignStmt::make(AssignExpr::make(id(name), value));
+}
+
+static Stmt local(const string & name, Expr value)
+{
+    return VarStmt::make(name, AnyType::make(), value);
+}
+
+static int countOp(IRFunction * f, IROp op)
+{
+    int n = 0;
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        for (size_t i = 0; i < f->blocks[k]->instrs.size(); ++i)
+            n += f->blocks[k]->instrs[i]->op == op;
+    return n;
+}
+
+// while n > 0: body; n = n - 1, optimized
+static IRFunction * loop(Stmt body)
+{
+    IRFunction * f = lowerToIR(def2("g", WhileStmt::make(GTExpr::make(id("n"), num(0)),
+        block({body, assign("n", MinusExpr::make(id("n"), num(1)))}))));
+    optimizeIR(f);
+    return f;
+}
+
+static IRInstr * findOp(IRFunction * f, IROp op)
+{
+    for (size_t k = 0; k < f->blocks.size(); ++k)
+        for (size_t i = 0; i < f->blocks[k]->instrs.size(); ++i)
+            if (f->blocks[k]->instrs[i]->op == op)
+                return f->blocks[k]->instrs[i];
+    return 0;
+}
+
+static string text(IRFunction * f)
+{
+    ostringstream out;
+    out << f;
+    return out.str();
+}
+
+// What body writes to stdout, through cout and the runtime's buffer alike.
+static string stdoutOf(void (*body)())
+{
+    char path[] = "/tmp/IRTestXXXXXX";
+    int fd = mkstemp(path);
+    int saved = dup(1);
+    cout.flush();
+    dup2(fd, 1);
+    body();
+    runtimeOut().flush();
+    dup2(saved, 1);
+    close(saved);
+    close(fd);
+    ifstream in(path);
+    string out((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    remove(path);
+    return out;
+}
+
+static StmtList cachedProgram;
+
+// A -k miss: the front end runs with its output recorded for the cache.
+static void cacheMiss()
+{
+    TeeBuffer tee(cout);
+    frontEndOutput = &tee;
+    cout << "*** Exit Scope f ***" << endl; // as the checker's dumps are, under -5
+    do_homework(cachedProgram);
+    frontEndOutput = 0;
+}
+
+static void cacheHit()
+{
+    CHECK(runFromIRCache(irCacheFile, irSourceHash));
+}
+
+int main()
+{
+    // True and 1 are different constants; two Trues are one
+    IRFunction * f = lowerToIR(def("f", block({printStmt({BoolConstExpr::make(1),
+        IntConstExpr::make(1), BoolConstExpr::make(1), BoolConstExpr::make(0), IntConstExpr::make(0)})})));
+    optimizeIR(f);
+    IRInstr * p = findOp(f, irPrint);
+    CHECK(p && p->args.size() == 5);
+    if (p && p->args.size() == 5)
+    {
+        CHECK(p->args[0] != p->args[1] && p->args[0] == p->args[2]);
+        CHECK(p->args[3] != p->args[4]);
+    }
+    CHECK(text(f).find("const True") != string::npos);
+    CHECK(text(f).find("const 1") != string::npos);
+
+    // n * m twice is one value; n * m in another def is not shared
+    f = lowerToIR(def2("f", printStmt({TimesExpr::make(id("n"), id("m")), TimesExpr::make(id("n"), id("m"))})));
+    optimizeIR(f);
+    p = findOp(f, irPrint);
+    CHECK(countOp(f, irMul) == 1);
+    CHECK(p && p->args.size() == 2 && p->args[0] == p->args[1]);
+
+    // n == m does not trap, so it leaves the loop; m + m may trap (an any
+    // holding a str, or ints past 62 bits), so it stays where a loop that
+    // runs zero times never reaches it
+    IRFunction * g = loop(printStmt({EQExpr::make(id("m"), num(3))}));
+    CHECK(findOp(g, irEQ) && findOp(g, irEQ)->block != findOp(g, irPrint)->block);
+    g = loop(printStmt({PlusExpr::make(id("m"), id("m"))}));
+    CHECK(findOp(g, irAdd) && findOp(g, irAdd)->block == findOp(g, irPrint)->block);
+    g = loop(printStmt({LTExpr::make(id("m"), num(3))}));
+    CHECK(findOp(g, irLT) && findOp(g, irLT)->block == findOp(g, irPrint)->block);
+
+    // an unused value goes unless computing it may trap
+    f = lowerToIR(def2("f", block({local("x", EQExpr::make(id("n"), id("m"))),
+                                   local("y", PlusExpr::make(id("n"), id("m"))),
+                                   local("z", TimesExpr::make(id("n"), id("m")))})));
+    optimizeIR(f);
+    CHECK(!findOp(f, irEQ) && findOp(f, irAdd) && findOp(f, irMul));
+
+    // if n: x = 1 else: x = 2; print(x) joins the two through a phi, one
+    // input per pred; an x neither side assigns needs none
+    f = lowerToIR(def2("f", block({local("x", num(0)),
+                                   IfStmt::make(id("n"), assign("x", num(1)), assign("x", num(2))),
+                                   printStmt({id("x")})})));
+    optimizeIR(f);
+    IRInstr * phi = findOp(f, irPhi);
+    CHECK(phi && phi->args.size() == 2 && phi->targets.size() == 2);
+    if (phi && phi->args.size() == 2 && phi->targets.size() == 2)
+    {
+        CHECK(phi->args[0]->op == irConst && phi->args[1]->op == irConst);
+        CHECK(phi->args[0]->imm + phi->args[1]->imm == 3);
+        CHECK(phi->block->preds.size() == 2);
+        CHECK(find(phi->block->preds.begin(), phi->block->preds.end(), phi->targets[0]) != phi->block->preds.end());
+        CHECK(find(phi->block->preds.begin(), phi->block->preds.end(), phi->targets[1]) != phi->block->preds.end());
+        CHECK(findOp(f, irPrint)->args[0] == phi);
+    }
+    f = lowerToIR(def2("f", block({local("x", id("m")),
+                                   IfStmt::make(id("n"), printStmt({num(1)}), printStmt({num(2)})),
+                                   printStmt({id("x")})})));
+    optimizeIR(f);
+    CHECK(!findOp(f, irPhi));
+    // the loop counter of a while is a phi in the loop header
+    g = loop(printStmt({id("n")}));
+    phi = findOp(g, irPhi);
+    CHECK(phi && findOp(g, irPrint)->args[0] == phi);
+
+    IRModule * m = new IRModule();
+    m->add(f);
+    const char * path = "/tmp/IRTest.cache";
+    CHECK(writeIRCache(path, m, 42, "printed\n"));
+    string output;
+    IRModule * back = readIRCache(path, 42, output);
+    CHECK(back && back->functions.size() == 1 && output == "printed\n");
+    if (back && back->functions.size() == 1)
+        CHECK(text(back->functions[0]) == text(f));
+    CHECK(!readIRCache(path, 43, output));
+    // the flags the IR or the output depend on are part of the key
+    int budget = inlineBudget;
+    inlineBudget = budget + 1;
+    CHECK(!readIRCache(path, 42, output));
+    inlineBudget = budget;
+    irDump = !irDump;
+    CHECK(!readIRCache(path, 42, output));
+    irDump = !irDump;
+    CHECK(readIRCache(path, 42, output));
+    remove(path);
+
+    // def f(n: int) -> int: return n + 1
+    // print(f(2))
+    // a -k hit prints what the miss printed, and under -6 runs the cached IR
+    cachedProgram = list<Stmt>({
+        DefStmt::make("f", list<Stmt>({ParamStmt::make("n", IntType::make())}), IntType::make(),
+                      ReturnStmt::make(PlusExpr::make(id("n"), num(1)))),
+        printStmt({CallExpr::make(id("f"), list<Expr>({num(2)}))})});
+    irCacheFile = path;
+    irSourceHash = 99;
+    irDump = true;
+    HW = 5;
+    string miss = stdoutOf(cacheMiss);
+    CHECK(miss == stdoutOf(cacheHit));
+    CHECK(miss.find("Exit Scope f") != string::npos && miss.find("def f") != string::npos);
+    irDump = false;
+    HW = 6;
+    ST.reset();
+    CHECK(!readIRCache(path, 99, output)); // the mode is part of the key
+    miss = stdoutOf(cacheMiss);
+    CHECK(miss == stdoutOf(cacheHit));
+    CHECK(miss == "*** Exit Scope f ***\n3\n");
+    HW = 0;
+    irCacheFile = 0;
+    remove(path);
+
+    // a called name resolves outward through the enclosing defs, but not
+    // through a class body
+    IRModule * calls = new IRModule();
+    const char * names[] = {"k", "f", "f.k", "f.g", "f.g.h", "C.k", "C.m", "C.m.n", "D.k"};
+    for (size_t i = 0; i < sizeof names / sizeof *names; ++i)
+        calls->add(new IRFunction(names[i]));
+    calls->bases["C"];
+    calls->bases["D"].push_back("C");
+    CHECK(calls->functionFor("f.g.h", "k")->name == "f.k");
+    CHECK(calls->functionFor("f.g.h", "h")->name == "f.g.h");
+    CHECK(calls->functionFor("f.g", "g")->name == "f.g");
+    CHECK(calls->functionFor("k", "k")->name == "k");
+    CHECK(calls->functionFor("C.m", "k")->name == "k");
+    CHECK(calls->functionFor("C.m.n", "k")->name == "k");
+    CHECK(calls->functionFor("C.m.n", "n")->name == "C.m.n");
+    CHECK(!calls->functionFor("f", "m"));
+    CHECK(calls->methodFor("D", "m")->name == "C.m");
+    CHECK(calls->methodFor("D", "k")->name == "D.k");
+
+    // after inlining, a call keeps meaning what it meant in its own def:
+    // helper's k is the top-level one (recursive, so never inlined), not
+    // the outer.k nested in the def helper is inlined into
+    Expr callK = CallExpr::make(IdentExpr::make("k"), 0);
+    IRModule * nested = new IRModule();
+    nested->add(lowerToIR(def("k", block({CallStmt::make(callK)}))));
+    IRFunction * outer = lowerToIR(def("outer", block({CallStmt::make(CallExpr::make(IdentExpr::make("helper"), 0))})));
+    nested->add(outer);
+    IRFunction * outerK = lowerToIR(def("k", block({printStmt({IntConstExpr::make(2)})})));
+    outerK->name = "outer.k";
+    nested->add(outerK);
+    nested->add(lowerToIR(def("helper", block({CallStmt::make(callK)}))));
+    inlineCalls(nested);
+    CHECK(nested->qualified);
+    CHECK(!findOp(outer, irPrint)); // outer.k was not inlined in its place
+    CHECK(findOp(outer, irCall) && findOp(outer, irCall)->name == "k");
+
+    return testResult();
+}
@@ -0,0 +1,173 @@
+// The baseline JIT (Jit.h) against the IR executor: each def is run both
+// ways on the same arguments and must give the same value, or trap both
+// ways when an int leaves 62 bits.
+
+#include "Test.h"
+
+static Stmt block(std::initializer_list<Stmt> stmts)
+{
+    return BlockStmt::make(list<Stmt>(stmts));
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+static Expr num(int v) { return IntConstExpr::make(v); }
+
+static Stmt assign(const string & name, Expr value)
+{
+    return AssignStmt::make(AssignExpr::make(id(name), value));
+}
+
+static Stmt local(const string & name, Expr init)
+{
+    return VarStmt::make(name, IntType::make(), init);
+}
+
+static Stmt def(const string & name, std::initializer_list<string> params, Stmt body)
+{
+    vector<Stmt> p;
+    for (std::initializer_list<string>::const_iterator i = params.begin(); i != params.end(); ++i)
+        p.push_back(ParamStmt::make(*i, IntType::make()));
+    StmtList L = 0;
+    for (size_t i = p.size(); i-- > 0; )
+        L = new StmtPair(p[i], L);
+    return DefStmt::make(name, L, 0, body);
+}
+
+static vector<Value> values(const vector<Int> & args)
+{
+    vector<Value> v;
+    for (size_t i = 0; i < args.size(); ++i)
+        v.push_back(Value::fromInt(args[i]));
+    return v;
+}
+
+// f(args) interpreted: the result, or "trap".
+static string interpreted(IRModule * m, IRFunction * f, const vector<Int> & args)
+{
+    int threshold = jitThreshold;
+    jitThreshold = 0;
+    Executor x(m);
+    ostringstream out;
+    try
+    {
+        out << x.call(f, values(args));
+    }
+    catch (RuntimeTrap &)
+    {
+        out << "trap";
+    }
+    jitThreshold = threshold;
+    return out.str();
+}
+
+// f(args) compiled: the result, or "trap" for JIT_OVERFLOW.
+static string compiled(JitCode code, bool returnsBool, const vector<Int> & args)
+{
+    Int a[6] = {0, 0, 0, 0, 0, 0};
+    for (size_t i = 0; i < args.size(); ++i)
+        a[i] = args[i];
+    Int r = code(a[0], a[1], a[2], a[3], a[4], a[5]);
+    ostringstream out;
+    if (r == JIT_OVERFLOW)
+        out << "trap";
+    else
+        out << (returnsBool ? Value::fromBool(r) : Value::fromInt(r));
+    return out.str();
+}
+
+int main()
+{
+    inlineBudget = 0;
+    StmtList program = list<Stmt>({
+        // def sumSquares(n): s = 0; i = 0
+        //                    while i < n: s = s + i * i; i = i + 1
+        //                    return s
+        def("sumSquares", {"n"}, block({local("s", num(0)), local("i", num(0)),
+            WhileStmt::make(LTExpr::make(id("i"), id("n")), block({
+                assign("s", PlusExpr::make(id("s"), TimesExpr::make(id("i"), id("i")))),
+                assign("i", PlusExpr::make(id("i"), num(1)))})),
+            ReturnStmt::make(id("s"))})),
+        // def max3(a, b, c): m = a; if b > m: m = b
+        //                    if c > m: m = c
+        //                    return m
+        def("max3", {"a", "b", "c"}, block({local("m", id("a")),
+            IfStmt::make(GTExpr::make(id("b"), id("m")), assign("m", id("b")), 0),
+            IfStmt::make(GTExpr::make(id("c"), id("m")), assign("m", id("c")), 0),
+            ReturnStmt::make(id("m"))})),
+        // def truth(x): return not x          (an int operand)
+        def("truth", {"x"}, ReturnStmt::make(NotExpr::make(id("x")))),
+        // def differ(x): return (x == 0) != (x < 5)
+        def("differ", {"x"}, ReturnStmt::make(NEExpr::make(EQExpr::make(id("x"), num(0)),
+                                                           LTExpr::make(id("x"), num(5))))),
+        // def pow2(k): r = 1
+        //              while k > 0: r = r * 2; k = k - 1
+        //              return r
+        def("pow2", {"k"}, block({local("r", num(1)),
+            WhileStmt::make(GTExpr::make(id("k"), num(0)), block({
+                assign("r", TimesExpr::make(id("r"), num(2))),
+                assign("k", MinusExpr::make(id("k"), num(1)))})),
+            ReturnStmt::make(id("r"))})),
+        // def twice(x): return -x - x
+        def("twice", {"x"}, ReturnStmt::make(MinusExpr::make(UnaryMinusExpr::make(id("x")), id("x")))),
+        // def either(x): if x > 0: return True
+        //                return 1
+        def("either", {"x"}, block({IfStmt::make(GTExpr::make(id("x"), num(0)),
+            ReturnStmt::make(BoolConstExpr::make(1)), 0), ReturnStmt::make(num(1))}))});
+    IRModule * m = compileProgram(program);
+
+    struct Case { const char * def; vector<Int> args; };
+    Int big = 1LL << 60;
+    Case cases[] = {
+        {"sumSquares", {0}}, {"sumSquares", {10}}, {"sumSquares", {1000}}, {"sumSquares", {-5}},
+        {"max3", {1, 2, 3}}, {"max3", {3, 2, 1}}, {"max3", {2, 3, 1}}, {"max3", {-1, -1, -1}},
+        {"truth", {0}}, {"truth", {5}}, {"truth", {-1}},
+        {"differ", {0}}, {"differ", {3}}, {"differ", {7}},
+        {"pow2", {10}}, {"pow2", {60}}, {"pow2", {61}}, {"pow2", {70}},
+        {"twice", {big / 2}}, {"twice", {big}}, {"twice", {big + 1}}, {"twice", {-big}},
+        {"twice", {-big - 1}},
+    };
+    int traps = 0;
+    for (size_t i = 0; i < sizeof cases / sizeof *cases; ++i)
+    {
+        IRFunction * f = m->byName[cases[i].def];
+        bool returnsBool;
+        JitCode code = compileIR(f, returnsBool);
+        CHECK(code);
+        if (!code)
+            continue;
+        string want = interpreted(m, f, cases[i].args);
+        string got = compiled(code, returnsBool, cases[i].args);
+        if (want != got)
+            cerr << cases[i].def << '(' << cases[i].args[0] << "): " << want << " vs " << got << endl;
+        CHECK(want == got);
+        traps += want == "trap";
+    }
+    CHECK(traps == 5);
+    CHECK(interpreted(m, m->byName["truth"], {5}) == "False");
+    CHECK(interpreted(m, m->byName["pow2"], {60}) == to_string(big));
+
+    bool returnsBool;
+    CHECK(!compileIR(m->byName["either"], returnsBool)); // True on one path, 1 on the other
+
+    // through the executor: compiled on the second call, and a call that
+    // overflows is rerun interpreted and traps at its row
+    jitThreshold = 2;
+    int compiledBefore = jitStats.compiled;
+    Executor x(m);
+    IRFunction * pow2 = m->byName["pow2"];
+    CHECK(x.call(pow2, values({3})) == Value::fromInt(8));
+    CHECK(x.call(pow2, values({4})) == Value::fromInt(16));
+    CHECK(jitStats.compiled == compiledBefore + 1);
+    CHECK(x.call(pow2, values({5})) == Value::fromInt(32));
+    string trap;
+    try
+    {
+        x.call(pow2, values({61}));
+    }
+    catch (RuntimeTrap & t)
+    {
+        trap = t.message;
+    }
+    CHECK(trap == "int out of range");
+    return testResult();
+}
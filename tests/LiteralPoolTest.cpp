@@ -0,0 +1,28 @@
+// Constant nodes (Expr.h): make() hands out one node per literal, and the
+// str index holds no copy of a literal's bytes.
+
+#include "Test.h"
+
+int main()
+{
+    LiteralPool & pool = literalPool();
+    CHECK(BoolConstExpr::make(1) == BoolConstExpr::make(2));
+    CHECK(BoolConstExpr::make(1) != BoolConstExpr::make(0));
+    CHECK(NoneConstExpr::make() == NoneConstExpr::make());
+    CHECK(IntConstExpr::make(7) == IntConstExpr::make(7));
+    CHECK(IntConstExpr::make(1000) != IntConstExpr::make(1000)); // past the small-int cache
+
+    long made = pool.made, shared = pool.shared;
+    Expr a = StrConstExpr::make("a table row");
+    string copy = "a table row";
+    CHECK(StrConstExpr::make(copy) == a);
+    CHECK(StrConstExpr::make("another") != a);
+    CHECK(pool.made == made + 2 && pool.shared == shared + 1);
+    LiteralPool::StrIndex::iterator p = pool.strs.find(&copy);
+    CHECK(p != pool.strs.end() && p->first == &static_cast<StrConstExpr *>(a)->value);
+
+    ostringstream out;
+    pool.put(out);
+    CHECK(out.str().find("*** Literal Pool: ") == 0);
+    return testResult();
+}
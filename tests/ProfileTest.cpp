@@ -0,0 +1,69 @@
+// The profiler (Profile.h) under the executor: exact call counts per def
+// and sampled stacks that name the def and row that were running.
+
+#include "Test.h"
+
+static Stmt block(std::initializer_list<Stmt> stmts)
+{
+    return BlockStmt::make(list<Stmt>(stmts));
+}
+
+static Expr id(const string & name) { return IdentExpr::make(name); }
+static Expr num(int v) { return IntConstExpr::make(v); }
+
+static Expr call(const string & fn, std::initializer_list<Expr> args)
+{
+    return CallExpr::make(id(fn), list<Expr>(args));
+}
+
+static Stmt assign(const string & name, Expr value)
+{
+    return AssignStmt::make(AssignExpr::make(id(name), value));
+}
+
+int main()
+{
+    inlineBudget = 0; // each def keeps a frame of its own
+    Profiler & p = profiler();
+    p.counting = true;
+    // def fib(n): if n < 2: return n
+    //             return fib(n - 1) + fib(n - 2)
+    // fib(10)
+    Stmt fib = DefStmt::make("fib", list<Stmt>({ParamStmt::make("n", IntType::make())}), 0, block({
+        IfStmt::make(LTExpr::make(id("n"), num(2)), ReturnStmt::make(id("n")), 0),
+        ReturnStmt::make(PlusExpr::make(call("fib", {MinusExpr::make(id("n"), num(1))}),
+                                        call("fib", {MinusExpr::make(id("n"), num(2))})))}));
+    CHECK(runProgram(compileProgram(list<Stmt>({fib, CallStmt::make(call("fib", {num(10)}))}))));
+    ostringstream calls;
+    p.putCalls(calls);
+    CHECK(calls.str() == "*** Call Counts ***\n177 fib\n1 __main__\n");
+
+    // a trap unwinds the shadow stack with the frames
+    diagnostics().echo = false;
+    Stmt deep = DefStmt::make("deep", list<Stmt>({ParamStmt::make("n", IntType::make())}), 0,
+        ReturnStmt::make(DivideExpr::make(num(1), id("n"))));
+    CHECK(!runProgram(compileProgram(list<Stmt>({deep, CallStmt::make(call("deep", {num(0)}))}))));
+    p.counting = false;
+
+    // def spin(): i = 0
+    //             while i < 3000000: i = i + 1   (row 12)
+    // spin()                                     (row 20)
+    row = 11;
+    Stmt init = assign("i", num(0));
+    row = 12;
+    Stmt loop = WhileStmt::make(LTExpr::make(id("i"), num(3000000)),
+                                assign("i", PlusExpr::make(id("i"), num(1))));
+    Stmt spin = DefStmt::make("spin", 0, 0, block({VarStmt::make("i", IntType::make(), 0), init, loop}));
+    row = 20;
+    Stmt top = CallStmt::make(call("spin", {}));
+    CHECK(p.startSampling());
+    CHECK(runProgram(compileProgram(list<Stmt>({spin, top}))));
+    p.stopSampling();
+    ostringstream folded;
+    p.putFolded(folded);
+    string stacks = folded.str();
+    CHECK(stacks.find("__main__:20;spin:12 ") != string::npos);
+    CHECK(stacks.find("deep") == string::npos); // nothing sampled outside a run
+    CHECK(stacks.find("__main__:20;__main__") == string::npos);
+    return testResult();
+}
@@ -0,0 +1,98 @@
+// Quickening (Quicken.h): sites settle on the form their operands show and
+// re-quicken on a miss, and every form gives the generic op's result, its
+// 62-bit and bounds traps included.
+
+#include "Test.h"
+
+template <typename Op>
+static string trapOf(Op op)
+{
+    try
+    {
+        op();
+    }
+    catch (RuntimeTrap & t)
+    {
+        return t.message;
+    }
+    return "";
+}
+
+static Value ints(std::initializer_list<Int> elements)
+{
+    HeapObject * l = makeList(IntType::make());
+    for (std::initializer_list<Int>::const_iterator i = elements.begin(); i != elements.end(); ++i)
+        listAppend(l, Value::fromInt(*i));
+    return Value::fromObject(l);
+}
+
+static string str(Value v)
+{
+    ostringstream out;
+    out << v;
+    return out.str();
+}
+
+int main()
+{
+    // + settles on ints and stays there while the operands are ints
+    QuickSite add;
+    Value one = Value::fromInt(1), two = Value::fromInt(2);
+    CHECK(quickAdd(add, one, two) == Value::fromInt(3));
+    CHECK(add.form == quickInts && add.slow == 1);
+    Value big = Value::fromInt(MAX_VALUE_INT - 1), neg = Value::fromInt(MIN_VALUE_INT);
+    CHECK(quickAdd(add, big, one) == Value::fromInt(MAX_VALUE_INT));
+    CHECK(trapOf([&] { quickAdd(add, big, two); }) == "int out of range");
+    Value minusOne = Value::fromInt(-1);
+    CHECK(trapOf([&] { quickAdd(add, neg, minusOne); }) == "int out of range");
+    CHECK(quickAdd(add, neg, big) == Value::fromInt(-2));
+    CHECK(add.form == quickInts && add.slow == 1 && add.fast == 4);
+
+    // a str misses, re-quickens and concatenates; a list + concatenates;
+    // anything else is a type error, not a str concatenation
+    Value ab = makeStr("ab"), cd = makeStr("cd");
+    CHECK(str(quickAdd(add, ab, cd)) == "abcd" && add.form == quickStrs);
+    Value l = ints({1, 2}), m = ints({3});
+    CHECK(str(quickAdd(add, l, m)) == "[1, 2, 3]");
+    Value t = Value::fromBool(true);
+    CHECK(quickAdd(add, t, one) == Value::fromInt(2));
+    CHECK(trapOf([&] { quickAdd(add, ab, one); }) == "unsupported operand types for +");
+    CHECK(trapOf([&] { quickAdd(add, l, ab); }) == "unsupported operand types for +");
+    Value none;
+    CHECK(trapOf([&] { quickAdd(add, none, none); }) == "unsupported operand types for +");
+    CHECK(add.form == quickGeneric); // lists have no + form of their own
+    CHECK(quickAdd(add, one, two) == Value::fromInt(3));
+
+    // comparisons: True == 1, strs ordered, other values only (in)equal
+    QuickSite cmp;
+    CHECK(quickCompare(cmp, irLT, one, two) && cmp.form == quickInts);
+    CHECK(quickCompare(cmp, irEQ, t, one));
+    CHECK(quickCompare(cmp, irLT, ab, cd) && !quickCompare(cmp, irEQ, ab, cd));
+    CHECK(quickCompare(cmp, irNE, none, one) && !quickCompare(cmp, irEQ, l, one));
+    CHECK(trapOf([&] { quickCompare(cmp, irLT, none, one); }) == "unsupported operand types for a comparison");
+
+    // indexing: negative indices count from the end, and every form checks bounds
+    QuickSite get;
+    Value xs = ints({10, 20, 30});
+    CHECK(quickGetIndex(get, xs, Value::fromInt(0)) == Value::fromInt(10) && get.form == quickIntList);
+    CHECK(quickGetIndex(get, xs, Value::fromInt(-1)) == Value::fromInt(30) && get.fast == 1);
+    CHECK(quickGetIndex(get, xs, Value::fromInt(-3)) == Value::fromInt(10));
+    CHECK(trapOf([&] { quickGetIndex(get, xs, Value::fromInt(3)); }) == "list index out of range");
+    CHECK(trapOf([&] { quickGetIndex(get, xs, Value::fromInt(-4)); }) == "list index out of range");
+    HeapObject * flags = makeList(BoolType::make());
+    listAppend(flags, t);
+    Value fs = Value::fromObject(flags);
+    CHECK(quickGetIndex(get, fs, Value::fromInt(-1)) == t && get.form == quickBoolList);
+    CHECK(trapOf([&] { quickGetIndex(get, fs, Value::fromInt(1)); }) == "list index out of range");
+    HeapObject * anys = makeList(AnyType::make());
+    listAppend(anys, ab);
+    Value as = Value::fromObject(anys);
+    CHECK(quickGetIndex(get, as, Value::fromInt(0)) == ab && get.form == quickAnyList);
+    CHECK(quickGetIndex(get, as, Value::fromInt(-1)) == ab);
+    CHECK(trapOf([&] { quickGetIndex(get, as, Value::fromInt(-2)); }) == "list index out of range");
+    CHECK(str(quickGetIndex(get, cd, Value::fromInt(-1))) == "d");
+    CHECK(trapOf([&] { quickGetIndex(get, cd, Value::fromInt(2)); }) == "str index out of range");
+    CHECK(trapOf([&] { quickGetIndex(get, one, one); }) == "index into a value that is neither a list nor a str");
+    CHECK(trapOf([&] { quickGetIndex(get, xs, ab); }) == "unsupported operand type for an index");
+    return testResult();
+}
@@ -0,0 +1,47 @@
+// Source rows: a node keeps the first line it was built from, and a
+// failed check reports the row of the node being checked, not the line
+// the scanner stopped on.
+
+#include "Test.h"
+
+int main()
+{
+    diagnostics().echo = false;
+
+    row = 3;
+    Expr x = IdentExpr::make("x");
+    row = 4;
+    Expr y = IdentExpr::make("y");
+    Expr one = IntConstExpr::make(1); // pooled, so it has no row of its own
+    row = 5;
+    Expr sum = PlusExpr::make(PlusExpr::make(one, y), x);
+    CHECK(sum->row == 3);
+    Stmt var = VarStmt::make("s", IntType::make(), sum);
+    CHECK(var->row == 3);
+    Stmt ret = ReturnStmt::make(one);
+    CHECK(ret->row == 5);
+
+    row = 99; // check() runs after the whole file is parsed
+    {
+        CheckingRow at(var->row);
+        requireIntType(StrType::make());
+    }
+    requireIntType(StrType::make()); // outside any node
+    requireLocation(sum);
+    {
+        CheckingRow at(ret->row);
+        semantic_error("undeclared");
+    }
+    CHECK(checkRow() == -1);
+
+    vector<Diagnostic> & d = diagnostics().list;
+    CHECK(d.size() == 4);
+    if (d.size() == 4)
+    {
+        CHECK(d[0].kind == semanticError && d[0].row == 3);
+        CHECK(d[1].row == -1);
+        CHECK(d[2].row == 3);
+        CHECK(d[3].row == 5);
+    }
+    return testResult();
+}
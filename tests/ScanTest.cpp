@@ -0,0 +1,71 @@
+// splitAtLogicalLines and scanInParallel (ScanUtils.h).
+
+#include "Test.h"
+
+static bool cutsAtLineStarts(const string & src, const vector<size_t> & cuts)
+{
+    for (size_t k = 1; k + 1 < cuts.size(); ++k)
+        if (src[cuts[k] - 1] != '\n' || !startsLogicalLine(&src[cuts[k]], &src[0] + src.size()))
+            return false;
+    return cuts.front() == 0 && cuts.back() == src.size();
+}
+
+// Every cut must fall at a line whose predecessor is a complete logical line.
+static bool cutsAfterCompleteLines(const string & src, const vector<size_t> & cuts)
+{
+    for (size_t k = 1; k + 1 < cuts.size(); ++k)
+    {
+        size_t nl = cuts[k] - 1;
+        if (nl > 0 && src[nl - 1] == '\\')
+            return false;
+        if (nl > 1 && src[nl - 1] == '\r' && src[nl - 2] == '\\')
+            return false;
+    }
+    return true;
+}
+
+static void countLines(const char * b, const char * e, bool last, vector<int> & out)
+{
+    for (const char * p = b; p < e; ++p)
+        if (*p == '\n')
+            out.push_back(1);
+    if (last)
+        out.push_back(0);
+}
+
+int main()
+{
+    string plain;
+    for (int i = 0; i < 100; ++i)
+        plain += "x = " + to_string(i) + "\n";
+    vector<size_t> cuts = splitAtLogicalLines(plain.data(), plain.size(), 4);
+    CHECK(cuts.size() == 5);
+    CHECK(cutsAtLineStarts(plain, cuts));
+
+    // Every line but the first continues the one before it, so there is
+    // only one logical line and no split point.
+    string continued = "total = 1 + \\\n";
+    for (int i = 0; i < 100; ++i)
+        continued += "2 + \\\n";
+    continued += "3\n";
+    cuts = splitAtLogicalLines(continued.data(), continued.size(), 4);
+    CHECK(cuts.size() == 2);
+
+    string crlf = "a = 1 + \\\r\nb\r\nc = 2\r\n";
+    cuts = splitAtLogicalLines(crlf.data(), crlf.size(), 8);
+    CHECK(cutsAfterCompleteLines(crlf, cuts));
+
+    string mixed;
+    for (int i = 0; i < 200; ++i)
+        mixed += i % 3 ? "y = [1,\n2]\nz = 'a\\' b'\n" : "w = 1 + \\\nv\n";
+    cuts = splitAtLogicalLines(mixed.data(), mixed.size(), 16);
+    CHECK(cuts.size() > 2);
+    CHECK(cutsAtLineStarts(mixed, cuts));
+    CHECK(cutsAfterCompleteLines(mixed, cuts));
+
+    vector<int> lines = scanInParallel<int>(mixed.data(), mixed.size(), 8, countLines);
+    vector<int> serial;
+    countLines(mixed.data(), mixed.data() + mixed.size(), true, serial);
+    CHECK(lines == serial);
+    return testResult();
+}
@@ -0,0 +1,89 @@
+// Frame slots (SymTab.h): globals, params and locals get (depth, slot)
+// pairs as they are declared, a function's scope opens its own frame, and
+// class attributes get offsets per class instead of global slots.
+
+#include "Test.h"
+
+static Symbol func(SymTab & st, const string & name, SymbolList params)
+{
+    Symbol fn = FuncSymbol::make(name, params, FuncType::make(name, params, IntType::make()));
+    st.declare(fn);
+    st.enterScope(name, params, fn);
+    return fn;
+}
+
+static Symbol attribute(SymTab & st, const string & name)
+{
+    Symbol sy = VarSymbol::make(name, IntType::make());
+    st.declare(sy);
+    return sy;
+}
+
+// Declares class name with attributes names and builds its layout.
+static ClassType * defineClass(SymTab & st, const string & name, TypeList bases,
+                               const vector<string> & names)
+{
+    ClassType * ct = static_cast<ClassType *>(ClassType::make(0));
+    Symbol cs = ClassSymbol::make(name, ct);
+    st.declare(cs);
+    st.enterScope(name, 0, cs);
+    for (size_t i = 0; i < names.size(); ++i)
+        attribute(st, names[i]);
+    ct->scopeHolder = new SymbolListPair(st.exitScope(), 0);
+    ct->buildMethodTable(bases);
+    return ct;
+}
+
+int main()
+{
+    SymTab st;
+    Symbol g = attribute(st, "g");
+    CHECK(g->depth == 0 && g->slot == 0);
+
+    Symbol a = ParamSymbol::make("a", IntType::make());
+    Symbol b = ParamSymbol::make("b", IntType::make());
+    FuncSymbol * f = static_cast<FuncSymbol *>(func(st, "f", list<Symbol>({a, b})));
+    CHECK(a->depth == 1 && a->slot == 0);
+    CHECK(b->depth == 1 && b->slot == 1);
+    Symbol local = attribute(st, "local");
+    CHECK(local->depth == 1 && local->slot == 2);
+    Symbol inner = func(st, "inner", 0);
+    Symbol deep = attribute(st, "deep");
+    CHECK(deep->depth == 2 && deep->slot == 0);
+    st.exitScope();
+    CHECK(static_cast<FuncSymbol *>(inner)->frameSize == 1);
+    st.enterScope("block"); // a nested block shares the function's frame
+    Symbol blockVar = attribute(st, "blockVar");
+    CHECK(blockVar->depth == 1 && blockVar->slot == 3);
+    st.exitScope();
+    st.exitScope();
+    CHECK(f->frameSize == 4);
+
+    ClassType * base = defineClass(st, "Base", 0, {"x", "y"});
+    CHECK(st.globalFrameSize() == 1); // attributes took no global slots
+    CHECK(base->fieldIndex("x") == 0 && base->fieldIndex("y") == 1);
+    CHECK(base->fields.size() == 2 && base->fields[1]->slot == 1);
+    CHECK(base->fields[0]->depth == -1);
+
+    ClassType * other = defineClass(st, "Other", 0, {"y", "w"});
+    ClassType * sub = defineClass(st, "Sub", list<Type>({base, other}), {"z", "x"});
+    CHECK(sub->fields.size() == 4);
+    CHECK(sub->fieldIndex("x") == 0 && sub->fieldIndex("y") == 1); // first base kept
+    CHECK(sub->fieldIndex("w") == 2 && sub->fieldIndex("z") == 3);
+    CHECK(base->fieldIndex("x") == 0 && base->fields[0] != sub->fields[0]);
+
+    Symbol h = attribute(st, "h");
+    CHECK(h->depth == 0 && h->slot == 1);
+
+    // the owner is passed, not looked up: a var of the def's name in the
+    // enclosing scope does not stop the body getting its own frame
+    Symbol c = ParamSymbol::make("c", IntType::make());
+    FuncSymbol * shadowed = static_cast<FuncSymbol *>(
+        FuncSymbol::make("h", list<Symbol>({c}), FuncType::make("h", list<Symbol>({c}), IntType::make())));
+    st.enterScope("h", list<Symbol>({c}), shadowed);
+    CHECK(c->depth == 1 && c->slot == 0);
+    st.exitScope();
+    CHECK(shadowed->frameSize == 1);
+    CHECK(st.globalFrameSize() == 2);
+    return testResult();
+}
@@ -0,0 +1,46 @@
+// The vector span scanners (ScanUtils.h) against a byte loop, at every
+// start offset and length around the 16- and 32-byte block sizes.
+
+#include "Test.h"
+
+static const char * byteSpan(const char * p, const char * end, CharClass cls)
+{
+    while (p < end && inCharClass(*p, cls))
+        ++p;
+    return p;
+}
+
+int main()
+{
+    const CharClass classes[] = {isBlank, isDigit, isIdentChar};
+    string text;
+    unsigned seed = 1;
+    for (int i = 0; i < 4096; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        static const char pool[] = "    \t\t0123456789abcXYZ_ +-()\x80\xff";
+        text += pool[(seed >> 16) % (sizeof pool - 1)];
+    }
+    int mismatches = 0;
+    for (int c = 0; c < 3; ++c)
+        for (size_t start = 0; start < 200; ++start)
+            for (size_t len = 0; len < 70; ++len)
+            {
+                const char * p = text.data() + start;
+                if (spanCharClass(p, p + len, classes[c]) != byteSpan(p, p + len, classes[c]))
+                    ++mismatches;
+            }
+    CHECK(mismatches == 0);
+
+    string run(100, '7');
+    CHECK(scanDigits(run.data(), run.data() + run.size()) == run.data() + run.size());
+    CHECK(scanIdentifier(run.data(), run.data() + 40) == run.data() + 40);
+    string blanks = "  \t  x";
+    CHECK(skipBlanks(blanks.data(), blanks.data() + blanks.size()) == blanks.data() + 5);
+
+    const char * after;
+    string line = "\t  x";
+    CHECK(countIndent(line.data(), line.data() + line.size(), &after) == TAB_WIDTH + 2);
+    CHECK(*after == 'x');
+    return testResult();
+}
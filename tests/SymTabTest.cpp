@@ -0,0 +1,77 @@
+// Scope filters (SymTab.h): a lookup must find exactly what a scan of
+// every open scope would.  Cached type names must follow shadowing.
+
+#include "Test.h"
+
+// The innermost declaration of name, by scanning every scope.
+static Symbol scanAll(SymTab & st, const string & name)
+{
+    for (SymbolListList s = st.topScope(); s; s = s->next)
+        if (Symbol sy = SymTab::findSymbolInList(name, s->info))
+            return sy;
+    return 0;
+}
+
+int main()
+{
+    ScopeFilter f;
+    for (int i = 0; i < 100; ++i)
+        f.add(ScopeFilter::keyFor("n" + to_string(i)));
+    bool all = true;
+    for (int i = 0; i < 100; ++i)
+        all = all && f.mayContain(ScopeFilter::keyFor("n" + to_string(i)));
+    CHECK(all); // no false negatives
+
+    SymTab st;
+    for (int depth = 0; depth < 12; ++depth)
+    {
+        st.enterScope("scope" + to_string(depth));
+        for (int i = 0; i < 40; ++i)
+            if ((i + depth) % 3 == 0) // some names shadow outer ones
+                st.declare(VarSymbol::make("v" + to_string(i), IntType::make()));
+    }
+    int mismatches = 0;
+    for (int i = 0; i < 60; ++i)
+    {
+        string name = "v" + to_string(i);
+        if (st.findSymbol(name) != scanAll(st, name))
+            ++mismatches;
+    }
+    CHECK(mismatches == 0);
+    CHECK(st.findSymbol("int") != 0);
+    CHECK(st.findSymbol("absent") == 0);
+    CHECK(st.getStats().scopesSkipped > 0);
+
+    st.exitScope();
+    CHECK(st.findSymbol("v11") == scanAll(st, "v11"));
+
+    // a type name resolves once, until a declaration of it enters or leaves scope
+    Type ct = ClassType::make(0);
+    Symbol student = ClassSymbol::make("Student", ct);
+    st.declare(student);
+    CHECK(st.findTypeSymbol("Student") == student);
+    long lookups = st.getStats().lookups;
+    CHECK(st.findTypeSymbol("Student") == student);
+    CHECK(st.getStats().lookups == lookups && st.getStats().typeCacheHits == 1);
+    st.enterScope("shadowing");
+    Symbol inner = TypeSymbol::make("Student", IntType::make());
+    st.declare(inner);
+    CHECK(st.findTypeSymbol("Student") == inner);
+    st.exitScope();
+    CHECK(st.findTypeSymbol("Student") == student);
+
+    // a bound annotation points at the root, not at the IdentType it names
+    IdentType * named = static_cast<IdentType *>(IdentType::make("Student"));
+    named->bind(ct);
+    IdentType * alias = static_cast<IdentType *>(IdentType::make("Alias"));
+    alias->bind(named);
+    CHECK(alias->type == ct && named->type == ct);
+    CHECK(alias->isSameType(ct));
+
+    // reset drops the open scopes, as checkSource does between calls
+    st.reset();
+    CHECK(st.topScope() && !st.topScope()->next);
+    CHECK(st.findSymbol("v11") == 0 && st.findSymbol("int") != 0);
+    CHECK(st.findTypeSymbol("Student") == 0);
+    return testResult();
+}
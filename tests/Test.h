@@ -0,0 +1,37 @@
+// *** TESTS ***
+//
+// Each test is a program whose exit status is the number of failed
+// CHECKs.  Build it against the objects compiled with -DLIBRARY=1 (see
+// FrontEnd.h), for example
+//
+//     g++ -std=c++11 -DLIBRARY=1 -I.. EscapeTest.cpp <library objects> -pthread
+
+#include "../all.h"
+
+static int testFailures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            cerr << __FILE__ << ':' << __LINE__ << ": CHECK failed: " #cond << endl; \
+            ++testFailures; \
+        } \
+    } while (0)
+
+inline int testResult()
+{
+    cerr << (testFailures ? "FAILED" : "ok") << endl;
+    return testFailures;
+}
+
+// A list of nodes for building trees by hand: list<Expr>({a, b}).
+template <class T>
+ListPair<T> * list(std::initializer_list<T> items)
+{
+    vector<T> v(items);
+    ListPair<T> * head = 0;
+    for (size_t i = v.size(); i-- > 0; )
+        head = new ListPair<T>(v[i], head);
+    return head;
+}
@@ -0,0 +1,18 @@
+// Trace points: debug() records under the debug category only in builds
+// made with -DTRACE=1, and only once that category is enabled.
+
+#include "Test.h"
+
+int main()
+{
+    debug("before -t");
+    CHECK(traceRing().count == 0);
+    CHECK(traceRing().enable("debug,types"));
+    CHECK(!traceRing().enable("debug,nonsense"));
+    debug("after -t");
+    trace(traceScopes, "scopes are off");
+    CHECK(traceRing().count == (TRACE ? 1 : 0));
+    if (TRACE && traceRing().count == 1)
+        CHECK(traceRing().messages[0] == "after -t");
+    return testResult();
+}
@@ -0,0 +1,60 @@
+// Runtime values (Value.h): 62-bit ints trap instead of wrapping, list
+// indexes are checked and count from the end when negative, and each list
+// representation reads back what was stored.
+
+#include "Test.h"
+
+// Runs f and returns the message of the RuntimeTrap it threw, or "".
+template <typename F>
+string trapOf(F f)
+{
+    try
+    {
+        f();
+    }
+    catch (RuntimeTrap & t)
+    {
+        return t.message;
+    }
+    return "";
+}
+
+int main()
+{
+    CHECK(Value::fromInt(MAX_VALUE_INT).asInt() == MAX_VALUE_INT);
+    CHECK(Value::fromInt(MIN_VALUE_INT).asInt() == MIN_VALUE_INT);
+    CHECK(Value::fromInt(-7).asInt() == -7);
+    CHECK(trapOf([] { Value::fromInt(MAX_VALUE_INT + 1); }) == "int out of range");
+    CHECK(trapOf([] { Value::fromInt(MIN_VALUE_INT - 1); }) == "int out of range");
+    CHECK(trapOf([] { Value::fromInt(1LL << 62); }) != "");
+
+    Value seven = makeStr("seven!!");
+    CHECK(seven.isShortStr() && strString(seven) == "seven!!");
+    Value eight = makeStr("seven!!!");
+    CHECK(eight.isObject() && strEquals(strConcat(seven, makeStr("!")), eight));
+
+    Type types[] = {IntType::make(), BoolType::make(), StrType::make()};
+    HeapKind kinds[] = {intListObj, boolListObj, anyListObj};
+    for (int k = 0; k < 3; ++k)
+    {
+        HeapObject * l = makeList(types[k]);
+        CHECK(l->kind == kinds[k]);
+        for (int i = 0; i < 70; ++i)
+            listAppend(l, k == 1 ? Value::fromBool(i % 3 == 0)
+                          : k == 0 ? Value::fromInt(i) : makeStr(to_string(i)));
+        CHECK(listLength(l) == 70);
+        CHECK(listGet(l, 69) == listGet(l, -1));
+        CHECK(listGet(l, 0) == listGet(l, -70));
+        CHECK(trapOf([l] { listGet(l, 70); }) == "list index out of range");
+        CHECK(trapOf([l] { listGet(l, -71); }) == "list index out of range");
+        CHECK(trapOf([l] { listSet(l, 70, Value::fromInt(0)); }) == "list index out of range");
+        Value v = k == 1 ? Value::fromBool(true) : k == 0 ? Value::fromInt(-5) : makeStr("x");
+        listSet(l, -2, v);
+        CHECK(valueEquals(listGet(l, 68), v));
+        CHECK(listContains(l, v));
+        long n = 0;
+        listForEach(l, [&n](Value) { ++n; });
+        CHECK(n == 70);
+    }
+    return testResult();
+}